@@ -0,0 +1,63 @@
+/**
+ * @file bench.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Kernel latency benchmark firmware, built with RTX_BENCHMARK=1.
+ */
+
+#ifndef INC_BENCH_H_
+#define INC_BENCH_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+
+#if RTX_BENCHMARK
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#define BENCH_SAMPLES          100    //measured samples per primitive and task count
+#define BENCH_WARMUP           4      //samples discarded before measuring
+#define BENCH_DEADLINE         2      //deadline of the controller and partner tasks, in ticks
+#define BENCH_FILLER_DEADLINE  60000  //deadline of background tasks, long enough to never run first
+#define BENCH_HIST_BINS        16     //histogram bins, the last one collects everything above
+#define BENCH_HIST_WIDTH       32     //cycles per histogram bin
+#define BENCH_IRQ_TIMEOUT      1000   //ticks the interrupt benchmark task sleeps waiting for EXTI
+#ifndef BENCH_IRQ_SOFTWARE
+#define BENCH_IRQ_SOFTWARE     1      //raise EXTI line 13 from software instead of waiting for B1 presses
+#endif
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Replaces the application in main. Creates the benchmark controller task and starts the
+ *         kernel. For 2, 4, 8 ... MAX_TASKS - 2 tasks the controller measures the cycles taken by
+ *         osYield, osYieldTo, osSleep, osCreateDeadlineTask and an interrupt wakeup, and by picking
+ *         the next task with the old linear scan (pick_scan) and with the ready queue (pick_queue).
+ *         It prints one UART line per primitive:
+ *
+ *             BENCH,<primitive>,<tasks>,<min>,<avg>,<max>
+ *
+ *         The counts come from the DWT cycle counter, or from SysTick when the counter does not
+ *         run (QEMU). Never returns.
+ */
+void bench_start(void);
+
+/*
+ * @brief: Called first thing in EXTI15_10_IRQHandler. Timestamps the interrupt for the irq_wake
+ *         benchmark, which measures from here until the task woken with osWakeFromISR runs. Its
+ *         results are also printed as a histogram:
+ *
+ *             BENCH_HIST,irq_wake,<tasks>,<lowest cycles in bin>,<samples>
+ */
+void bench_irq_entry(void);
+
+#endif /* RTX_BENCHMARK */
+
+#endif /* INC_BENCH_H_ */
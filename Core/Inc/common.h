@@ -9,7 +9,57 @@
 #define INC_COMMON_H_
 
 
-#define MAX_TASKS       16    //maximum number of tasks in the system
+#ifndef MAX_TASKS
+#define MAX_TASKS       16    //maximum number of tasks in the system, build option up to 256
+#endif
+#define TICKLESS_IDLE   1     //stop the periodic tick while the null task runs
+#define KERNEL_IRQ_PRIORITY 5 //most urgent NVIC priority allowed to call the kernel, 0-4 are never masked
+#ifndef RTX_BENCHMARK
+#define RTX_BENCHMARK   0     //build the latency benchmark firmware (bench.c) instead of the application
+#endif
+#ifndef RTX_TRACE
+#define RTX_TRACE       0     //record kernel events into trace_buffer (k_trace.h), compiled out when 0
+#endif
+#define TRACE_RECORDS   256   //trace ring buffer length in records, a power of two
+#ifndef STACK_PAINT
+#define STACK_PAINT     1     //fill new task stacks with STACK_PAINT_WORD so peak use can be measured
+#endif
+#define STACK_PAINT_WORD 0xC5C5C5C5 //pattern left in stack words a task never wrote
+#ifndef STACK_GUARD
+#define STACK_GUARD     1     //no-access guard region at the bottom of the running task's stack, where the port has one
+#endif
+
+// Ports, chosen at build time with RTX_PORT
+#define PORT_CM4        0     //STM32F401, Cortex-M4F (port_cm4.c, lab1.s)
+#define PORT_POSIX      1     //Linux host process (Port/posix)
+#ifndef RTX_PORT
+#define RTX_PORT        PORT_CM4
+#endif
+
+// Scheduling policies, chosen at build time with SCHED_POLICY
+#define SCHED_EDF       0     //earliest deadline first
+#define SCHED_RM        1     //fixed priority, deadline monotonic
+#ifndef SCHED_POLICY
+#define SCHED_POLICY    SCHED_EDF
+#endif
+#define PRIORITY_LEVELS 64    //number of fixed priorities under SCHED_RM, 0 is the most urgent
+
+// Constant bandwidth server given to osCreateTask tasks under SCHED_EDF
+#define CBS_DEFAULT_BUDGET  1     //ticks of execution per server period
+#define CBS_DEFAULT_PERIOD  5     //server period and relative deadline, in ticks
+
+// CPU load accounting
+#define CPU_LOAD_WINDOW     1000  //ticks per window reported by osGetCpuLoad
+
+// Admission control
+#define UTIL_FULL              1000000 //utilization of a fully loaded CPU, in parts per million
+#define ADMISSION_MAX_POINTS   1000    //demand test evaluations before falling back to the density test
+
+// Deadline miss policies, set per task with osSetMissPolicy
+#define MISS_POLICY_NONE      0  //count the miss, the late job runs on and the next job follows it
+#define MISS_POLICY_CALLBACK  1  //as MISS_POLICY_NONE, then call the task's miss handler
+#define MISS_POLICY_SKIP      2  //drop the job that is due next, the late job takes its slot
+#define MISS_POLICY_DEMOTE    3  //run the task below every task not demoted, and drop its reservation
 
 // Bool alternatives
 #define TRUE            1
@@ -24,11 +74,24 @@
 #define STACK_SIZE      0x200 //min. size of each task’s stack
 #define MAIN_STACK_SIZE 0x400
 
+// Task stack pool (k_stack.c), kept apart from the k_mem heap. Three classes, smallest first, each
+// size a multiple of 32 bytes. A class with a count of 0 is left out.
+#ifndef STACK_POOL_SIZE_0
+#define STACK_POOL_SIZE_0   0x200 //bytes per stack
+#define STACK_POOL_COUNT_0  12    //stacks in the class
+#define STACK_POOL_SIZE_1   0x400
+#define STACK_POOL_COUNT_1  2
+#define STACK_POOL_SIZE_2   0x800
+#define STACK_POOL_COUNT_2  1
+#endif
+
 // Task States
 #define DORMANT         0     //state of terminated task
 #define READY           1     //state of task that can be scheduled but is not running
 #define RUNNING         2     //state of running task
 #define SLEEPING        3     //state of sleeping task
+#define ZOMBIE          4     //state of exited task whose stack and TID are not reclaimed yet
+#define BLOCKED         5     //state of task waiting for a mutex or semaphore
 
 // Return Codes
 #define RTX_ERR         -1
@@ -0,0 +1,46 @@
+/**
+ * @file k_crit.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Nestable kernel critical sections, BASEPRI based on the target.
+ */
+
+#ifndef INC_K_CRIT_H_
+#define INC_K_CRIT_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+#include "port.h"
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Enters a kernel critical section. Interrupts at priority KERNEL_IRQ_PRIORITY and below,
+ *         including SysTick, PendSV and SVC, are held off. More urgent interrupts keep running, so
+ *         they must never call the kernel. Sections nest; a pended context switch happens when the
+ *         outermost one ends. Do not issue SVC inside a section, it would escalate to a HardFault.
+ *
+ * @return: The previous mask, to be passed to k_crit_exit.
+ */
+static inline U32 k_crit_enter(void)
+{
+	return port_crit_enter();
+}
+
+/*
+ * @brief: Leaves a kernel critical section.
+ *
+ * @param prev: value returned by the matching k_crit_enter.
+ */
+static inline void k_crit_exit(U32 prev)
+{
+	port_crit_exit(prev);
+}
+
+#endif /* INC_K_CRIT_H_ */
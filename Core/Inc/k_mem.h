@@ -14,6 +14,7 @@
 
 #include "common.h"
 #include "k_task.h"
+#include <stddef.h>
 
 /************************************************
  *               DEFINITIONS
@@ -21,14 +22,12 @@
 
 #define METADATA_SECRET_KEY      0b10011001 // Used to verify validity of pointer provided for deallocation
 #define MAX_LEVEL                15         // Exponent for max size, (2^15)
+#define LEAF_LEVEL               10         // Deepest level of the buddy tree, 2^(MAX_LEVEL - LEAF_LEVEL) byte blocks
 
 /************************************************
  *               TYPEDEFS
  ************************************************/
 
-// used for specifying size of memory blocks
-typedef unsigned int size_t;
-
 typedef struct block_metadata {
 	U8 secret_key;                 // used for checking validity in deallocation
 	U8 is_allocated;               
@@ -0,0 +1,123 @@
+/**
+ * @file k_sched.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief EDF ready queue header.
+ */
+
+#ifndef INC_K_SCHED_H_
+#define INC_K_SCHED_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Empties the ready queue. Called once from osKernelInit.
+ */
+void k_sched_init(void);
+
+/*
+ * @brief: Derives a task's scheduling parameters from its relative deadline. Under SCHED_RM this sets
+ *         the deadline monotonic priority. The lowest level is left to demoted tasks. Must be called
+ *         before the task is queued and whenever its relative deadline changes or it is demoted.
+ *
+ * @param tcb: TCB of the task.
+ */
+void k_sched_assign(TCB *tcb);
+
+/*
+ * @brief: Adds a READY task to the ready queue. The running task and the null task are never queued.
+ *
+ * @param tcb: TCB of the task to queue.
+ */
+void k_sched_insert(TCB *tcb);
+
+/*
+ * @brief: Removes a task from the ready queue. Does nothing if the task is not queued.
+ *
+ * @param tcb: TCB of the task to remove.
+ */
+void k_sched_remove(TCB *tcb);
+
+/*
+ * @brief: Restores the queue order after the deadline or priority of a queued task has changed.
+ *
+ * @param tcb: TCB of the task whose deadline changed.
+ */
+void k_sched_update(TCB *tcb);
+
+/*
+ * @brief: Returns the most urgent READY task without removing it from the queue.
+ *
+ * @return: TID of the most urgent task, or TID_NULL if no task is ready.
+ */
+task_t k_sched_peek(void);
+
+/*
+ * @brief: Removes and returns the most urgent READY task.
+ *
+ * @return: TID of the most urgent task, or TID_NULL if no task is ready.
+ */
+task_t k_sched_pop(void);
+
+/*
+ * @brief: Compares the urgency of two tasks. Under EDF, deadline ties are broken in favour of the
+ *         lower TID. Under SCHED_RM, tasks of equal priority do not preempt each other.
+ *
+ * @return: TRUE if task a must be scheduled before task b, FALSE otherwise.
+ */
+int k_sched_preempts(const TCB *a, const TCB *b);
+
+/*
+ * @brief: Like k_sched_preempts, but without the TID tie break, so tasks of equal urgency compare
+ *         as FALSE both ways.
+ *
+ * @return: TRUE if task a is strictly more urgent than task b, FALSE otherwise.
+ */
+int k_sched_more_urgent(const TCB *a, const TCB *b);
+
+/*
+ * @brief: Lends an owner the urgency of a task blocked on a mutex it holds, if that is more urgent
+ *         than what it already runs at: the deadline under EDF, the priority under SCHED_RM. The
+ *         task's own deadline and priority are left as they are. Requeues the owner if it is READY.
+ *
+ * @param owner: TCB of the mutex owner.
+ * @param waiter: TCB of the blocked task, whose own inherited urgency is passed on as well.
+ */
+void k_sched_inherit(TCB *owner, const TCB *waiter);
+
+/*
+ * @brief: Drops everything a task inherited, so it runs at its own urgency again. Requeues it if it
+ *         is READY.
+ *
+ * @param tcb: TCB of the task.
+ */
+void k_sched_inherit_reset(TCB *tcb);
+
+/*
+ * @brief: Returns the utilization a task reserves, wcet / period rounded up.
+ *
+ * @param tcb: TCB of the task.
+ * @return: Utilization in parts per UTIL_FULL, 0 for tasks without a wcet and demoted tasks.
+ */
+U32 k_sched_utilization(const TCB *tcb);
+
+/*
+ * @brief: Online admission test for a new task against all active tasks that declared a wcet. Under EDF
+ *         this is the utilization bound for implicit deadlines and the processor demand test once any
+ *         task has a deadline shorter than its period. Under SCHED_RM it is response time analysis.
+ *
+ * @param candidate: fully initialized TCB of the task to admit, not yet marked active.
+ * @return: RTX_OK if the task set stays schedulable, RTX_ERR otherwise.
+ */
+int k_sched_admit(const TCB *candidate);
+
+#endif /* INC_K_SCHED_H_ */
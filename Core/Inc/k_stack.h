@@ -0,0 +1,56 @@
+/**
+ * @file k_stack.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Task stack pool: fixed size classes in their own RAM, apart from the k_mem heap.
+ */
+
+#ifndef INC_K_STACK_H_
+#define INC_K_STACK_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#if (STACK_POOL_SIZE_0 % 32) || (STACK_POOL_SIZE_1 % 32) || (STACK_POOL_SIZE_2 % 32)
+#error "stack pool sizes must be multiples of 32 bytes"
+#endif
+#if STACK_POOL_SIZE_0 < STACK_SIZE || STACK_POOL_SIZE_1 < STACK_POOL_SIZE_0 || STACK_POOL_SIZE_2 < STACK_POOL_SIZE_1
+#error "stack pool classes must be at least STACK_SIZE and in ascending order"
+#endif
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Marks every stack in the pool free. Called from osKernelInit.
+ */
+void k_stack_init(void);
+
+/*
+ * @brief: Takes a stack from the smallest class that holds size bytes and has one free, in O(1).
+ *         Stacks are 32-byte aligned and carry no header.
+ *
+ * @param size: requested stack size in bytes, rounded up to the size of the class it came from.
+ * @return: Lowest address of the stack, or NULL if no class large enough has a free stack.
+ */
+U32* k_stack_alloc(U16* size);
+
+/*
+ * @brief: Returns a stack to its class in O(1). Nothing is written to the stack itself, so a task
+ *         may free the stack it is still running on.
+ *
+ * @param stack: address returned by k_stack_alloc.
+ * @return: RTX_OK on success, RTX_ERR if it is not a pool stack or already free.
+ */
+int k_stack_free(U32* stack);
+
+#endif /* INC_K_STACK_H_ */
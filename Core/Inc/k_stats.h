@@ -0,0 +1,59 @@
+/**
+ * @file k_stats.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Per-task CPU time accounting with the port's cycle counter (DWT on the target).
+ */
+
+#ifndef INC_K_STATS_H_
+#define INC_K_STATS_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+#include "port.h"
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Opens the first load window. Called from osKernelStart.
+ */
+void k_stats_init(void);
+
+/*
+ * @brief: Closes the load window once CPU_LOAD_WINDOW ticks have passed, refreshing every task's
+ *         cpu_load. Called from SysTick inside a kernel critical section.
+ */
+void k_stats_tick(void);
+
+/*
+ * @brief: Charges the cycles since the last switch to the outgoing task and counts the switch.
+ *         Called from new_task inside a kernel critical section, so it is kept to a few instructions.
+ *
+ * @param from: task that was running, already moved back to READY if it was preempted.
+ * @param to: task about to run.
+ */
+static inline void k_stats_switch(TCB *from, TCB *to)
+{
+	U32 now = port_cycles();
+
+	from->run_cycles += now - kernel_config.switch_stamp;
+	kernel_config.switch_stamp = now;
+	if (from != to)
+	{
+		to->switch_count++;
+		// Still READY without having yielded means it was pushed off the CPU.
+		if (from->state == TASK_READY && !kernel_config.yielding)
+		{
+			from->preempt_count++;
+		}
+	}
+	kernel_config.yielding = FALSE;
+}
+
+#endif /* INC_K_STATS_H_ */
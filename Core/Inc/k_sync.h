@@ -0,0 +1,138 @@
+/**
+ * @file k_sync.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Mutexes with deadline inheritance under EDF and priority inheritance under SCHED_RM, and
+ *        counting semaphores.
+ */
+
+#ifndef INC_K_SYNC_H_
+#define INC_K_SYNC_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+
+/************************************************
+ *               TYPEDEFS
+ ************************************************/
+
+// A mutex, owned by at most one task. Only touch it through the osMutex* calls.
+typedef struct mutex_t {
+	TCB* owner; //task holding the mutex, NULL if it is free
+	TCB* waiters; //tasks BLOCKED on the mutex, most urgent first, linked through wait_next
+	struct mutex_t* next_held; //next mutex held by the same owner
+}MUTEX;
+
+// A counting semaphore. Only touch it through the osSem* calls.
+typedef struct semaphore_t {
+	U32 count; //units available, always 0 while tasks wait
+	U32 max; //count a give may not go past
+	TCB* waiters; //tasks BLOCKED in osSemTake, most urgent first, linked through wait_next
+}SEMAPHORE;
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Initializes a mutex as free. Must be called before the mutex is first locked, and never
+ *         while a task holds it or waits on it.
+ *
+ * @param mutex: the mutex.
+ * @return: RTX_OK on success, RTX_ERR if mutex is NULL.
+ */
+int osMutexInit(MUTEX* mutex);
+
+/*
+ * @brief: Takes the mutex, blocking the calling task until it is free. While the task waits, the
+ *         owner runs with the task's deadline (SCHED_EDF) or priority (SCHED_RM) if that is more
+ *         urgent than its own, and passes it on to the owner of any mutex it waits on in turn. A
+ *         task is therefore only ever held up by the critical sections of less urgent tasks, and
+ *         never by tasks of middling urgency. Waiters are queued most urgent first and unlock
+ *         hands the mutex straight to the head of the queue. Not for use from interrupts.
+ *
+ * @param mutex: the mutex.
+ * @return: RTX_OK once the caller holds the mutex, RTX_ERR if mutex is NULL, the kernel is not
+ *          running, the caller already holds it, waiting would close a cycle of tasks blocked on
+ *          each other, or the null task would have to wait.
+ */
+int osMutexLock(MUTEX* mutex);
+
+/*
+ * @brief: Releases a mutex held by the calling task, handing it to the most urgent waiter. The
+ *         caller drops back to its own urgency, or to what it still inherits through other mutexes
+ *         it holds, and is preempted if the waiter or another READY task is now more urgent.
+ *
+ * @param mutex: the mutex.
+ * @return: RTX_OK on success, RTX_ERR if mutex is NULL, the kernel is not running or the caller
+ *          does not hold it.
+ */
+int osMutexUnlock(MUTEX* mutex);
+
+/*
+ * @brief: Hands every mutex a task holds on to its next waiter. Called by osTaskExit inside a kernel
+ *         critical section, so a task cannot exit with its waiters blocked forever.
+ *
+ * @param tcb: TCB of the exiting task.
+ */
+void k_sync_release_all(TCB* tcb);
+
+/*
+ * @brief: Re-sorts a BLOCKED task among the waiters after its deadline or priority changed, and
+ *         recomputes what the owners up the chain inherit from it. Does nothing for a task that is
+ *         not BLOCKED. Called inside a kernel critical section.
+ *
+ * @param tcb: TCB of the task whose deadline or priority changed.
+ */
+void k_sync_requeue(TCB* tcb);
+
+/*
+ * @brief: Initializes a semaphore. A max of 1 makes a binary semaphore, where gives beyond the first
+ *         fail until a task takes it. Never call it while tasks wait on the semaphore.
+ *
+ * @param sem: the semaphore.
+ * @param count: units initially available.
+ * @param max: highest count the semaphore can reach.
+ * @return: RTX_OK on success, RTX_ERR if sem is NULL, max is 0 or count is above max.
+ */
+int osSemInit(SEMAPHORE* sem, U32 count, U32 max);
+
+/*
+ * @brief: Takes one unit, blocking the calling task until one is given if the count is 0. Waiters are
+ *         queued most urgent first and the job's deadline keeps running while it waits. Unlike a
+ *         mutex a semaphore has no owner, so nothing is inherited. Not for use from interrupts.
+ *
+ * @param sem: the semaphore.
+ * @return: RTX_OK once the caller has a unit, RTX_ERR if sem is NULL, the kernel is not running,
+ *          or the count is 0 and the caller is the null task, which must never block.
+ */
+int osSemTake(SEMAPHORE* sem);
+
+/*
+ * @brief: Gives one unit. If tasks wait, it goes straight to the most urgent one, which is made READY
+ *         without the count changing, so no other task can take it first. The caller is preempted
+ *         only if that task is more urgent. Not for use from interrupts, see osSemGiveFromISR.
+ *
+ * @param sem: the semaphore.
+ * @return: RTX_OK on success, RTX_ERR if sem is NULL, the kernel is not running or the count is
+ *          already at max.
+ */
+int osSemGive(SEMAPHORE* sem);
+
+/*
+ * @brief: osSemGive for interrupt handlers. Rather than switching at once, it pends a switch for
+ *         exception return if the woken task preempts the interrupted one. Before osKernelStart no
+ *         task can wait, so it only adds to the count. Call it only from interrupts at priority
+ *         KERNEL_IRQ_PRIORITY or less urgent.
+ *
+ * @param sem: the semaphore.
+ * @return: RTX_OK on success, RTX_ERR if sem is NULL or the count is already at max, in which case
+ *          the give is lost.
+ */
+int osSemGiveFromISR(SEMAPHORE* sem);
+
+#endif /* INC_K_SYNC_H_ */
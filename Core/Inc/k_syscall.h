@@ -0,0 +1,187 @@
+/**
+ * @file k_syscall.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Supervisor call numbers and the unprivileged entry points to the kernel.
+ */
+
+#ifndef INC_K_SYSCALL_H_
+#define INC_K_SYSCALL_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+#include "k_sync.h"
+#include <stddef.h>
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+// SVC immediates, the index into the kernel's syscall table.
+#define SVC_PRIVILEGED              0   //switch the calling thread to privileged mode
+#define SVC_KERNEL_START            1   //restore the first task, used by osKernelStart
+#define SVC_CREATE_TASK             2
+#define SVC_CREATE_DEADLINE_TASK    3
+#define SVC_CREATE_PERIODIC_TASK    4
+#define SVC_CREATE_SERVER_TASK      5   //SCHED_EDF only
+#define SVC_YIELD                   6
+#define SVC_YIELD_TO                7
+#define SVC_PERIOD_YIELD            8
+#define SVC_SLEEP                   9
+#define SVC_TASK_EXIT               10
+#define SVC_TASK_INFO               11
+#define SVC_GET_TID                 12
+#define SVC_SET_DEADLINE            13
+#define SVC_SET_MISS_POLICY         14
+#define SVC_FREE_UTILIZATION        15
+#define SVC_MEM_ALLOC               16
+#define SVC_MEM_DEALLOC             17
+#define SVC_MEM_COUNT_EXTFRAG       18
+#define SVC_MUTEX_LOCK              19
+#define SVC_MUTEX_UNLOCK            20
+#define SVC_SEM_TAKE                21
+#define SVC_SEM_GIVE                22
+#define SVC_COUNT                   23
+
+/*
+ * Trap into the kernel with SVC #number. Arguments travel in R0-R3 and the result comes back in R0,
+ * which the handler writes into the stacked exception frame. number must be a literal constant.
+ */
+#define SVC_CALL(number, a0, a1, a2, a3) __extension__ ({ \
+	register U32 r0 __asm("r0") = (U32)(a0); \
+	register U32 r1 __asm("r1") = (U32)(a1); \
+	register U32 r2 __asm("r2") = (U32)(a2); \
+	register U32 r3 __asm("r3") = (U32)(a3); \
+	__asm volatile("svc %[num]" : "+r"(r0) : [num] "i"(number), "r"(r1), "r"(r2), "r"(r3) : "memory"); \
+	r0; })
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Dispatches a supervisor call through the syscall table. Called by SVC_Handler with the
+ *         exception frame of the caller.
+ *
+ * @param svc_args: stacked R0, R1, R2, R3, R12, LR, PC, xPSR of the calling context.
+ */
+void SVC_Handler_Main(unsigned int *svc_args);
+
+/*
+ * The calls below behave exactly like the os* and k_mem_* functions they are named after, but run
+ * them in handler mode through SVC, so they may be used by unprivileged tasks.
+ */
+
+static inline int sysCreateTask(TCB* task)
+{
+	return (int)SVC_CALL(SVC_CREATE_TASK, task, 0, 0, 0);
+}
+
+static inline int sysCreateDeadlineTask(int deadline, TCB* task)
+{
+	return (int)SVC_CALL(SVC_CREATE_DEADLINE_TASK, deadline, task, 0, 0);
+}
+
+static inline int sysCreatePeriodicTask(int period, int deadline, TCB* task)
+{
+	return (int)SVC_CALL(SVC_CREATE_PERIODIC_TASK, period, deadline, task, 0);
+}
+
+#if SCHED_POLICY == SCHED_EDF
+static inline int sysCreateServerTask(int budget, int period, TCB* task)
+{
+	return (int)SVC_CALL(SVC_CREATE_SERVER_TASK, budget, period, task, 0);
+}
+#endif
+
+static inline void sysYield(void)
+{
+	SVC_CALL(SVC_YIELD, 0, 0, 0, 0);
+}
+
+static inline int sysYieldTo(task_t TID)
+{
+	return (int)SVC_CALL(SVC_YIELD_TO, TID, 0, 0, 0);
+}
+
+static inline void sysPeriodYield(void)
+{
+	SVC_CALL(SVC_PERIOD_YIELD, 0, 0, 0, 0);
+}
+
+static inline void sysSleep(int timeInMs)
+{
+	SVC_CALL(SVC_SLEEP, timeInMs, 0, 0, 0);
+}
+
+static inline int sysTaskExit(void)
+{
+	return (int)SVC_CALL(SVC_TASK_EXIT, 0, 0, 0, 0);
+}
+
+static inline int sysTaskInfo(task_t TID, TCB* task_copy)
+{
+	return (int)SVC_CALL(SVC_TASK_INFO, TID, task_copy, 0, 0);
+}
+
+static inline task_t sysGetTID(void)
+{
+	return (task_t)SVC_CALL(SVC_GET_TID, 0, 0, 0, 0);
+}
+
+static inline int sysSetDeadline(int deadline, task_t TID)
+{
+	return (int)SVC_CALL(SVC_SET_DEADLINE, deadline, TID, 0, 0);
+}
+
+static inline int sysSetMissPolicy(task_t TID, int policy, void (*handler)(task_t tid))
+{
+	return (int)SVC_CALL(SVC_SET_MISS_POLICY, TID, policy, handler, 0);
+}
+
+static inline U32 sysGetFreeUtilization(void)
+{
+	return SVC_CALL(SVC_FREE_UTILIZATION, 0, 0, 0, 0);
+}
+
+static inline void* sysMemAlloc(size_t size)
+{
+	return (void*)SVC_CALL(SVC_MEM_ALLOC, size, 0, 0, 0);
+}
+
+static inline int sysMemDealloc(void* ptr)
+{
+	return (int)SVC_CALL(SVC_MEM_DEALLOC, ptr, 0, 0, 0);
+}
+
+static inline int sysMemCountExtfrag(size_t size)
+{
+	return (int)SVC_CALL(SVC_MEM_COUNT_EXTFRAG, size, 0, 0, 0);
+}
+
+// osMutexInit and osSemInit only write the object, unprivileged tasks call them directly.
+static inline int sysMutexLock(MUTEX* mutex)
+{
+	return (int)SVC_CALL(SVC_MUTEX_LOCK, mutex, 0, 0, 0);
+}
+
+static inline int sysMutexUnlock(MUTEX* mutex)
+{
+	return (int)SVC_CALL(SVC_MUTEX_UNLOCK, mutex, 0, 0, 0);
+}
+
+static inline int sysSemTake(SEMAPHORE* sem)
+{
+	return (int)SVC_CALL(SVC_SEM_TAKE, sem, 0, 0, 0);
+}
+
+static inline int sysSemGive(SEMAPHORE* sem)
+{
+	return (int)SVC_CALL(SVC_SEM_GIVE, sem, 0, 0, 0);
+}
+
+#endif /* INC_K_SYSCALL_H_ */
@@ -9,22 +9,30 @@
 #ifndef INC_K_TASK_H_
 #define INC_K_TASK_H_
 #include "common.h"
+#include <stdint.h>
 
 
 /************************************************
  *               DEFINITIONS
  ************************************************/
 
-#define SHPR2 *(uint32_t*)0xE000ED1C //for setting SVC priority, bits 31-24
-#define SHPR3 *(uint32_t*)0xE000ED20 //PendSV is bits 23-16
+#if MAX_TASKS > 256
+#error "MAX_TASKS must be at most 256"
+#endif
+
+// TID bitmaps: TID t is bit (31 - t % 32) of word t / 32, so CLZ finds the lowest TID first.
+#define TID_MAP_WORDS   ((MAX_TASKS + 31) / 32)
+#define TID_MAP_BIT(t)  (0x80000000U >> ((t) & 31))
 
 /************************************************
  *               TYPEDEFS
  ************************************************/
 
+typedef unsigned long long U64;
 typedef unsigned int U32;
 typedef unsigned short U16;
 typedef char U8;
+typedef uintptr_t UPTR; //integer that holds an address, 32 bits on the target
 
 //Task ID type.
 typedef unsigned int task_t;
@@ -34,7 +42,9 @@ enum task_state {
 	TASK_DORMANT = 0,
 	TASK_READY = 1,
 	TASK_RUNNING = 2,
-	TASK_SLEEPING = 3
+	TASK_SLEEPING = 3,
+	TASK_ZOMBIE = 4,
+	TASK_BLOCKED = 5
 };
 
 // Struct to contain all task data.
@@ -43,21 +53,61 @@ typedef struct task_control_block{
 	task_t tid; // task ID
 	U8 state; // task's state
 	U16 stack_size; // stack size. Must be a multiple of 8
-	U32 stack_high; // largest address for task stack
+	UPTR stack_high; // largest address for task stack
+	UPTR stack_guard; //lowest address of the guard region at the bottom of the stack, 0 if none
 	U32* SP; // stack pointer
 	U32* p_stack_mem; //pointer to address of dynamically allocated stack
 	U32 remaining_sleep_time;
 	U32 deadline; //a fixed deadline for a periodic task
-	U32 remaining_time; //decrements every tick, is initially equal to the deadline
+	U32 period; //release period, equal to the deadline unless created by osCreatePeriodicTask
+	U32 wcet; //worst case execution time per job in ticks, 0 if unknown (skips admission control)
+	U32 remaining_time; //ticks left until the deadline, filled in by osTaskInfo
+	U8 priority; //fixed priority derived from the deadline under SCHED_RM, 0 is the most urgent
+	U64 release; //kernel tick at which the current job was released
+	U64 abs_deadline; //kernel tick at which the current job is due, release + deadline
+	struct task_control_block* timer_next; //links in the sleep or release queue
+	struct task_control_block* timer_prev;
+	struct task_control_block** timer_list; //queue the task is linked on, NULL if none
+	U64 timer_expiry; //kernel tick at which the task's wakeup or deadline fires
+	U32 cbs_budget; //server budget per period (deadline) for a CBS task, 0 for a deadline task
+	U32 cbs_remaining; //budget left before the server deadline is postponed
+	U32 miss_count; //deadlines missed since creation
+	U32 worst_response; //longest release to completion time of a job, in ticks
+	U32 worst_lateness; //longest completion time past a job's deadline, in ticks
+	U8 miss_policy; //MISS_POLICY_* applied when a deadline is missed
+	U8 demoted; //TRUE once MISS_POLICY_DEMOTE has moved the task below every task that is not demoted
+	void (*miss_handler)(task_t tid); //called from SysTick under MISS_POLICY_CALLBACK
+	U64 run_cycles; //CPU cycles spent running since creation
+	U64 load_base; //run_cycles when the current load window opened
+	U32 cpu_load; //share of the CPU over the last load window, in parts per UTIL_FULL
+	U32 switch_count; //times the task was switched in
+	U32 preempt_count; //times the task was switched out while it still wanted to run
+	U16 stack_peak; //most stack bytes used since creation, filled in by osTaskInfo, 0 without STACK_PAINT
+	U64 inherit_deadline; //earliest deadline of a task blocked on a mutex this task holds, 0 if none
+	U8 inherit_priority; //as inherit_deadline under SCHED_RM, PRIORITY_LEVELS if none
+	struct mutex_t* held; //mutexes the task holds, linked through next_held
+	struct mutex_t* blocked_on; //mutex the task is BLOCKED on, NULL if none or a semaphore
+	struct task_control_block** wait_queue; //head of the mutex or semaphore queue the task is BLOCKED in, NULL if none
+	struct task_control_block* wait_next; //next task in wait_queue
 }TCB;
 
 
 //Master struct containing all data for kernel functions.
 typedef struct kernel_config_t {
 	TCB TCBS[MAX_TASKS];
-	U8 num_running_tasks;
+	U32 free_tids[TID_MAP_WORDS]; //set bit = TID available for a new task
+	U32 active_tids[TID_MAP_WORDS]; //set bit = TID in use, including the null task
+	U32 zombie_tids[TID_MAP_WORDS]; //set bit = task exited, its stack and TID wait for the reaper
+	U16 num_running_tasks;
 	U8 is_running; //as bool 0 = False else true
 	task_t running_task;
+	U64 tick_count; //monotonic ticks since osKernelInit
+	U32 utilization; //sum of admitted wcet / period, in parts per UTIL_FULL
+	task_t yield_to; //handoff target set by osYieldTo for the next switch, TID_NULL if none
+	U8 yielding; //TRUE if the running task gave up the CPU itself, not counted as a preemption
+	U32 switch_stamp; //DWT cycle count at the last switch
+	U32 load_stamp; //DWT cycle count when the current load window opened
+	U64 load_window_end; //tick at which the current load window closes
 }KERNEL_CONFIG;
 
 /************************************************
@@ -70,6 +120,15 @@ extern KERNEL_CONFIG kernel_config;
  *              FUNCTION DEFS
  ************************************************/
 
+/*
+ * @brief: Returns the first TID at or after from whose bit is set in a TID bitmap.
+ *
+ * @param map: TID bitmap of TID_MAP_WORDS words, e.g. kernel_config.active_tids.
+ * @param from: first TID to consider.
+ * @return: The TID found, or MAX_TASKS if there is none.
+ */
+task_t k_tid_map_next(const U32* map, task_t from);
+
 /*
  * @brief: Initializes all global kernel-level data structures and sets interrupt priorities.
  */
@@ -77,7 +136,11 @@ void osKernelInit(void);
 
 
 /*
- * @brief: Create a new task and register it with the RTX
+ * @brief: Create a new task and register it with the RTX. Under SCHED_EDF the task is an aperiodic
+ *         task served by a CBS with CBS_DEFAULT_BUDGET and CBS_DEFAULT_PERIOD. The server only
+ *         reserves its budget / period in admission control if task->wcet is non-zero, so up to
+ *         MAX_TASKS default tasks can be created, but without a wcet nothing guarantees they fit
+ *         alongside the admitted tasks.
  *
  * @param task: pointer to new task's TCB.
  * @return RTX_OK on success and RTX_ERR on failure
@@ -99,6 +162,16 @@ int osKernelStart(void);
  */
 void osYield(void);
 
+/*
+ * @brief: Same as osYield, but hands the CPU straight to the task with Id TID if the scheduling
+ *         policy allows it to run now, i.e. no READY task is more urgent. The switch then takes the
+ *         target without a scheduler pass. Otherwise this behaves exactly like osYield.
+ *
+ * @param TID: ID of the task to run next.
+ * @return: RTX_OK if a task with the given TID exists, and RTX_ERR otherwise.
+ */
+int osYieldTo(task_t TID);
+
 /*
  * @brief: Retrieve the information from the TCB of the task with id TID, and fill the TCB pointed to by task_copy.
  *
@@ -130,6 +203,17 @@ int osTaskExit(void);
  */
 void osSleep(int timeInMs);
 
+/*
+ * @brief: Wakes a task blocked in osSleep before its sleep time is up, so an interrupt handler can
+ *         hand work to a task. The task is released as a new job at the current tick and preempts
+ *         the running task if it is more urgent. Call it only from interrupts at priority
+ *         KERNEL_IRQ_PRIORITY or less urgent; more urgent interrupts are not masked by the kernel.
+ *
+ * @param TID: ID of the sleeping task.
+ * @return: RTX_OK if the task was woken, RTX_ERR if no such task exists or it is not SLEEPING.
+ */
+int osWakeFromISR(task_t TID);
+
 /*
  * @brief: Performs same operations as osYield, however does not reset the task's remaining time.
  */
@@ -142,22 +226,98 @@ void osPeriodYield(void);
 
 /*
  * @brief: Sets the deadline of the task with Id TID to the deadline stored in the deadline variable.
+ *         The new job's deadline counts from now. A task BLOCKED on a mutex or semaphore keeps
+ *         waiting, moved among the waiters by its new deadline, and the owner's inherited deadline
+ *         follows it.
  *
  * @param deadline: new deadline value.
  * @param TID: ID of task to be updated.
  * @return: RTX_OK if the deadline provided is positive and a task with the given TID exists and 
- *          is ready to run. Otherwise it returns RTX_ERR.
+ *          is ready to run. Otherwise it returns RTX_ERR. A task with a wcet is also refused a
+ *          deadline that would push the admitted utilization above UTIL_FULL.
  */
 int osSetDeadline(int deadline, task_t TID);
 
 /*
  * @brief: Create a new task and register it with the RTX if possible. This task has the deadline given in
- *         the deadline variable.
+ *         the deadline variable, which is also its period. If task->wcet is non-zero the task is only
+ *         admitted if the task set stays schedulable.
  *
  * @param deadline: deadline value for new task.
  * @param task: pointer to new task's TCB.
- * @return: RTX_OK on success and RTX_ERR on failure.
+ * @return: RTX_OK on success and RTX_ERR on failure, including when admission control rejects the task.
  */
 int osCreateDeadlineTask(int deadline, TCB* task);
 
+/*
+ * @brief: Create a periodic task with a constrained deadline (deadline <= period). Admission control is
+ *         applied as for osCreateDeadlineTask.
+ *
+ * @param period: time between job releases, in ticks.
+ * @param deadline: relative deadline of each job, in ticks.
+ * @param task: pointer to new task's TCB.
+ * @return: RTX_OK on success and RTX_ERR on failure.
+ */
+int osCreatePeriodicTask(int period, int deadline, TCB* task);
+
+/*
+ * @brief: Snapshot of every task's CPU share over the last complete CPU_LOAD_WINDOW ticks. The
+ *         null task's entry is the idle time. Run time, switch and preemption counts since
+ *         creation are also reported per task by osTaskInfo.
+ *
+ * @param loads: array of MAX_TASKS entries indexed by TID, filled in parts per UTIL_FULL, 0 for
+ *               unused TIDs.
+ * @return: RTX_OK on success, RTX_ERR if loads is NULL.
+ */
+int osGetCpuLoad(U32 *loads);
+
+/*
+ * @brief: Returns the CPU utilization not yet reserved by admitted tasks, i.e. tasks with a wcet and
+ *         osCreateServerTask servers.
+ *
+ * @return: Spare utilization in parts per UTIL_FULL.
+ */
+U32 osGetFreeUtilization(void);
+
+/*
+ * @brief: Choose what the kernel does when the task with Id TID is still READY or RUNNING at its
+ *         deadline. Every miss is counted in miss_count whatever the policy; osTaskInfo also reports
+ *         the worst response time and lateness of the task's completed jobs.
+ *
+ * @param TID: ID of the task.
+ * @param policy: one of the MISS_POLICY_* values.
+ * @param handler: function called with the TID under MISS_POLICY_CALLBACK. It runs in the SysTick
+ *                 handler, so it must be short and must not block.
+ * @return: RTX_OK on success, RTX_ERR for an unknown task or policy or a missing handler.
+ */
+int osSetMissPolicy(task_t TID, int policy, void (*handler)(task_t tid));
+
+/*
+ * @brief: Measures the most stack the task with Id TID has used since it was created. With
+ *         STACK_PAINT on, every word of a new task's stack is filled with STACK_PAINT_WORD, and the
+ *         stack is scanned up from its lowest address, or from above its guard region, to the first
+ *         word that changed. A result that reaches the bottom means the stack was used up, and may
+ *         have overflowed. osTaskInfo reports the same value in stack_peak.
+ *
+ * @param TID: ID of the task.
+ * @return: Peak use in bytes, or RTX_ERR for an unknown task or with STACK_PAINT off.
+ */
+int osGetStackPeak(task_t TID);
+
+#if SCHED_POLICY == SCHED_EDF
+/*
+ * @brief: Create an aperiodic or soft task served by a constant bandwidth server. The task may run for
+ *         budget ticks every period ticks at its server deadline; once the budget is used up the
+ *         deadline is postponed by one period, so it can never take more than budget / period of
+ *         the CPU away from deadline tasks. The server always reserves budget / period in admission
+ *         control.
+ *
+ * @param budget: server budget Q in ticks, 0 < budget <= period.
+ * @param period: server period T in ticks, also the task's relative deadline.
+ * @param task: pointer to new task's TCB.
+ * @return: RTX_OK on success and RTX_ERR on failure.
+ */
+int osCreateServerTask(int budget, int period, TCB* task);
+#endif
+
 #endif /* INC_K_TASK_H_ */
@@ -0,0 +1,96 @@
+/**
+ * @file k_timer.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Kernel tick and timer queue header.
+ */
+
+#ifndef INC_K_TIMER_H_
+#define INC_K_TIMER_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Empties the sleep and release queues. Called once from osKernelInit.
+ */
+void k_timer_init(void);
+
+/*
+ * @brief: Returns the kernel tick count. Safe to call from thread mode while SysTick is running.
+ *
+ * @return: Ticks since osKernelInit.
+ */
+U64 k_timer_now(void);
+
+/*
+ * @brief: Processes one kernel tick. Only the heads of the sleep and release queues are examined,
+ *         so the cost does not depend on the number of tasks.
+ *
+ * @return: TRUE if a task was woken or had its deadline renewed, FALSE otherwise.
+ */
+int k_timer_tick(void);
+
+/*
+ * @brief: Adds ticks that elapsed without k_timer_tick being called, e.g. while the tick was
+ *         suppressed. Must not be used to skip past the next timer event.
+ *
+ * @param ticks: number of elapsed ticks.
+ */
+void k_timer_advance(U32 ticks);
+
+/*
+ * @brief: Returns the number of ticks until the next timer event: the first sleeping task waking up
+ *         or the first job deadline expiring, whichever is sooner.
+ *
+ * @return: Ticks until the next event, or UINT_MAX if no task is sleeping or has a deadline running.
+ */
+U32 k_timer_next_wakeup(void);
+
+/*
+ * @brief: Puts a task on the sleep queue. It is released with tcb->release set to wake_time.
+ *
+ * @param tcb: TCB of the task to put to sleep.
+ * @param wake_time: absolute tick at which the task becomes READY, later than the current tick.
+ */
+void k_timer_sleep_until(TCB *tcb, U64 wake_time);
+
+/*
+ * @brief: Wakes a SLEEPING task before its wakeup time. The task becomes READY with a job released
+ *         at the current tick. Must be called inside a kernel critical section.
+ *
+ * @param tcb: TCB of the sleeping task.
+ */
+void k_timer_wake(TCB *tcb);
+
+/*
+ * @brief: (Re)arms the deadline of a READY or RUNNING task at tcb->abs_deadline.
+ *
+ * @param tcb: TCB of the task whose deadline was set.
+ */
+void k_timer_set_deadline(TCB *tcb);
+
+/*
+ * @brief: Removes a task from whichever timer queue it is on.
+ *
+ * @param tcb: TCB of the task.
+ */
+void k_timer_cancel(TCB *tcb);
+
+/*
+ * @brief: Returns the number of ticks until a queued task's timer fires.
+ *
+ * @param tcb: TCB of the task.
+ * @return: Ticks until the task's wakeup or deadline, or 0 if the task is not queued.
+ */
+U32 k_timer_remaining(const TCB *tcb);
+
+#endif /* INC_K_TIMER_H_ */
@@ -0,0 +1,95 @@
+/**
+ * @file k_trace.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Binary kernel event trace, recorded into a RAM ring buffer when built with RTX_TRACE=1.
+ */
+
+#ifndef INC_K_TRACE_H_
+#define INC_K_TRACE_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+#include "port.h"
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+// Event types. tools/trace_decode.py keeps the same numbering.
+#define TRACE_SWITCH    1   //tid switched in, arg = TID switched out
+#define TRACE_WAKE      2   //tid made READY, arg = 0 by its timer, 1 by osWakeFromISR, 2 by a mutex handoff, 3 by a semaphore give
+#define TRACE_SLEEP     3   //tid put on the sleep queue, arg = wakeup tick
+#define TRACE_ALLOC     4   //tid allocated memory, arg = address, 0 if the allocation failed
+#define TRACE_FREE      5   //tid freed memory, arg = address
+#define TRACE_MISS      6   //tid missed a deadline, arg = its miss count
+#define TRACE_CREATE    7   //tid created, arg = relative deadline
+#define TRACE_EXIT      8   //tid exited, arg = 0
+#define TRACE_BLOCK     9   //tid blocked on a mutex, arg = TID of the owner, or TID_NULL in osSemTake
+
+#define TRACE_MAGIC     0x54585452  //"RTXT" in memory, marks the start of a dump
+
+#if RTX_TRACE
+
+#if (TRACE_RECORDS & (TRACE_RECORDS - 1)) != 0
+#error "TRACE_RECORDS must be a power of two"
+#endif
+
+// One 12-byte event. Field order keeps the layout free of padding.
+typedef struct trace_record_t {
+	U32 cycles; //port_cycles(), the DWT cycle count on the target
+	U16 tick; //low 16 bits of the kernel tick, the time base when DWT does not run
+	U8 event; //TRACE_*
+	U8 tid;
+	U32 arg;
+}TRACE_RECORD;
+
+// The dump format read by tools/trace_decode.py.
+typedef struct trace_buffer_t {
+	U32 magic; //TRACE_MAGIC
+	U32 record_size; //sizeof(TRACE_RECORD)
+	U32 capacity; //TRACE_RECORDS
+	volatile U32 head; //records ever written, the next one goes to head % capacity
+	TRACE_RECORD records[TRACE_RECORDS];
+}TRACE_BUFFER;
+
+extern TRACE_BUFFER trace_buffer;
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Appends one record. Safe from any context without locking: the slot is claimed with an
+ *         atomic increment (LDREX/STREX on the target), so a record can only be torn if the reader
+ *         dumps while it is being written.
+ *
+ * @param event: TRACE_* event type.
+ * @param tid: task the event is about.
+ * @param arg: event specific argument.
+ */
+static inline void k_trace(U8 event, task_t tid, U32 arg)
+{
+	U32 slot = port_fetch_inc(&trace_buffer.head);
+	TRACE_RECORD *record = &trace_buffer.records[slot & (TRACE_RECORDS - 1)];
+	record->cycles = port_cycles();
+	record->tick = (U16)kernel_config.tick_count;
+	record->event = event;
+	record->tid = (U8)tid;
+	record->arg = arg;
+}
+
+// Arguments are not evaluated when tracing is compiled out.
+#define K_TRACE(event, tid, arg)  k_trace((event), (tid), (U32)(UPTR)(arg))
+
+#else
+
+#define K_TRACE(event, tid, arg)  ((void)0)
+
+#endif /* RTX_TRACE */
+
+#endif /* INC_K_TRACE_H_ */
@@ -0,0 +1,107 @@
+/**
+ * @file port.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Interface between the kernel and the hardware it runs on: context switch, tick source,
+ *        critical sections and the memory the kernel is given. One port is built, chosen by RTX_PORT.
+ */
+
+#ifndef INC_PORT_H_
+#define INC_PORT_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+
+/*
+ * Each port header defines, as static inline functions:
+ *   U32 port_crit_enter(void) / void port_crit_exit(U32 prev)   mask and unmask kernel interrupts
+ *   void port_pend_switch(void)    request a context switch once no critical section is held
+ *   U32* port_get_psp(void) / void port_set_psp(U32* sp)        saved context of the running task
+ *   U32 port_cycles(void)          free running cycle counter, modulo 2^32
+ *   U32 port_fetch_inc(volatile U32* value)                      atomic post-increment
+ *   UPTR port_stack_guard(U32* stack_mem)  lowest address of the guard region of a new task stack,
+ *                                  PORT_STACK_GUARD_SIZE bytes long, or 0 if the port has none
+ *   void port_set_stack_guard(UPTR guard)  arm the guard of the task being switched in, 0 for none
+ */
+#if RTX_PORT == PORT_POSIX
+#include "port_posix.h"
+#else
+#include "port_cm4.h"
+#endif
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * Implemented by the port.
+ */
+
+/*
+ * @brief: Sets up interrupt priorities, the FPU and the cycle counter. Called from osKernelInit.
+ */
+void port_init(void);
+
+/*
+ * @brief: Prepares a task's stack so that the first switch to it starts tcb->ptask.
+ *
+ * @param tcb: task being created, its tid and ptask are set.
+ * @param stack_top: highest address of the task's stack.
+ * @return: The saved context of the task, to be stored in tcb->SP.
+ */
+U32* port_stack_init(TCB* tcb, U32* stack_top);
+
+/*
+ * @brief: Returns the highest address of the null task's stack.
+ */
+U32* port_null_stack(void);
+
+/*
+ * @brief: Starts the tick and restores the task whose context was last given to port_set_psp.
+ *         Never returns.
+ */
+void port_start(void);
+
+/*
+ * @brief: Body of the null task. Waits, at low power where possible, until an interrupt may have
+ *         made a task ready.
+ */
+void port_idle(void);
+
+/*
+ * @brief: Returns the start of the 2^MAX_LEVEL byte region managed by k_mem.
+ */
+void* port_heap(void);
+
+/*
+ * @brief: Checks memory an unprivileged task passes to a system call against what the port lets
+ *         unprivileged code access, so the kernel does not fault on it in handler mode.
+ *
+ * @param addr: start of the memory.
+ * @param size: length in bytes.
+ * @return: TRUE if unprivileged code may read and write all of it, FALSE otherwise.
+ */
+int port_user_access(const void* addr, U32 size);
+
+/*
+ * Called by the port.
+ */
+
+/*
+ * @brief: Picks the next task to run. The port calls it with interrupts masked when a pended switch
+ *         is taken, after saving the running task's context where port_get_psp finds it, and then
+ *         restores the context given to port_set_psp.
+ */
+void new_task(void);
+
+/*
+ * @brief: Kernel part of the tick interrupt. Advances the timers, and pends a switch if a task was
+ *         released or woken.
+ */
+void k_tick(void);
+
+#endif /* INC_PORT_H_ */
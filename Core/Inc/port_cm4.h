@@ -0,0 +1,102 @@
+/**
+ * @file port_cm4.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Cortex-M4F port: BASEPRI critical sections, PendSV switches and the DWT cycle counter.
+ */
+
+#ifndef INC_PORT_CM4_H_
+#define INC_PORT_CM4_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+#include "stm32f4xx.h"
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+// BASEPRI value masking every interrupt that may call the kernel, see KERNEL_IRQ_PRIORITY.
+#define KERNEL_BASEPRI  (KERNEL_IRQ_PRIORITY << (8 - __NVIC_PRIO_BITS))
+
+// Stack guard: the smallest MPU region, no access even from privileged code, never executable.
+// Region 7 takes precedence over any other region that overlaps it.
+#define PORT_STACK_GUARD_SIZE  32
+#define MPU_GUARD_REGION       7
+#define MPU_GUARD_RASR         (MPU_RASR_XN_Msk | (4U << MPU_RASR_SIZE_Pos) | MPU_RASR_ENABLE_Msk) //2^(4+1) bytes
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+static inline U32 port_crit_enter(void)
+{
+	U32 prev = __get_BASEPRI();
+	// Only ever raises the mask, so a nested section cannot unmask an outer one.
+	__set_BASEPRI_MAX(KERNEL_BASEPRI);
+	__ISB();
+	return prev;
+}
+
+static inline void port_crit_exit(U32 prev)
+{
+	__set_BASEPRI(prev);
+}
+
+// PendSV runs as soon as BASEPRI and the active exception priority allow it.
+static inline void port_pend_switch(void)
+{
+	SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
+	__ISB();
+}
+
+// PendSV_Handler (lab1.s) keeps each task's context on its own stack, so the context is the PSP.
+static inline U32* port_get_psp(void)
+{
+	return (U32*)__get_PSP();
+}
+
+static inline void port_set_psp(U32* sp)
+{
+	__set_PSP((U32)sp);
+}
+
+// The first aligned 32 bytes of the stack. Pool stacks are aligned, so that is its bottom.
+static inline UPTR port_stack_guard(U32* stack_mem)
+{
+#if STACK_GUARD
+	return ((UPTR)stack_mem + PORT_STACK_GUARD_SIZE - 1) & ~(UPTR)(PORT_STACK_GUARD_SIZE - 1);
+#else
+	return 0;
+#endif
+}
+
+// Two stores to the MPU, the guard goes with the task's stack on every switch.
+static inline void port_set_stack_guard(UPTR guard)
+{
+#if STACK_GUARD
+	MPU->RBAR = guard | MPU_RBAR_VALID_Msk | MPU_GUARD_REGION;
+	MPU->RASR = guard != 0 ? MPU_GUARD_RASR : 0;
+#endif
+}
+
+static inline U32 port_cycles(void)
+{
+	return DWT->CYCCNT;
+}
+
+static inline U32 port_fetch_inc(volatile U32* value)
+{
+	U32 old;
+	do
+	{
+		old = __LDREXW(value);
+	} while (__STREXW(old + 1, value) != 0);
+	return old;
+}
+
+#endif /* INC_PORT_CM4_H_ */
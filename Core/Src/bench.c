@@ -0,0 +1,405 @@
+#include "bench.h"
+
+#if RTX_BENCHMARK
+
+#include "main.h"
+#include "k_task.h"
+#include "k_sched.h"
+#include "k_crit.h"
+#include "common.h"
+#include <stdio.h>
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal.h"
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+typedef struct bench_stat_t {
+	U32 min;
+	U32 max;
+	U64 sum;
+	U32 count;
+	U32 skipped; //warmup samples thrown away so far
+	U32 hist[BENCH_HIST_BINS];
+}BENCH_STAT;
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+static U8 use_dwt; //TRUE if DWT->CYCCNT advances, otherwise cycles are derived from SysTick
+static volatile BENCH_STAT stat;
+
+// Shared between the controller and the partner task.
+static volatile U32 bench_mark; //cycle count taken just before the controller gave up the CPU
+static volatile U8 bench_armed; //TRUE if the partner should record bench_mark on its next run
+static volatile U8 partner_stop;
+static volatile U8 filler_stop;
+static volatile task_t picked; //result of the last pick, kept so the scan is not optimized out
+static task_t controller_tid;
+
+// Shared between the EXTI handler and the interrupt benchmark task.
+static volatile U32 irq_stamp; //cycle count at EXTI15_10_IRQHandler entry
+static volatile U8 irq_woken; //TRUE if the last interrupt woke irq_tid
+static volatile U8 irq_stop;
+static volatile task_t irq_tid;
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// Start the DWT cycle counter and check that it is implemented. QEMU reads it as zero.
+static void cycles_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	U32 start = DWT->CYCCNT;
+	for (volatile int i = 0; i < 16; i++);
+	use_dwt = DWT->CYCCNT != start;
+}
+
+// Core clock cycles since reset, modulo 2^32.
+static U32 bench_cycles(void)
+{
+	if (use_dwt)
+	{
+		return DWT->CYCCNT;
+	}
+
+	// SysTick counts core cycles down from LOAD once per HAL tick. Re-read if a tick lands in between.
+	U32 tick;
+	U32 val;
+	do
+	{
+		tick = uwTick;
+		val = SysTick->VAL;
+		if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+		{
+			// The tick is due but masked by a critical section. Count it, and read VAL again in
+			// case it wrapped after the first read.
+			tick++;
+			val = SysTick->VAL;
+		}
+	} while (tick != uwTick);
+
+	U32 load = SysTick->LOAD;
+	return tick * (load + 1) + (load - val);
+}
+
+static void stat_reset(void)
+{
+	stat.min = 0xFFFFFFFF;
+	stat.max = 0;
+	stat.sum = 0;
+	stat.count = 0;
+	stat.skipped = 0;
+	for (int i = 0; i < BENCH_HIST_BINS; i++)
+	{
+		stat.hist[i] = 0;
+	}
+}
+
+static void stat_record(U32 cycles)
+{
+	if (stat.skipped < BENCH_WARMUP)
+	{
+		stat.skipped++;
+		return;
+	}
+	stat.min = cycles < stat.min ? cycles : stat.min;
+	stat.max = cycles > stat.max ? cycles : stat.max;
+	stat.sum += cycles;
+	stat.count++;
+
+	U32 bin = cycles / BENCH_HIST_WIDTH;
+	stat.hist[bin < BENCH_HIST_BINS ? bin : BENCH_HIST_BINS - 1]++;
+}
+
+static void stat_report(const char *name, U16 ntasks)
+{
+	printf("BENCH,%s,%u,%u,%u,%u\r\n", name, ntasks, stat.min, (U32)(stat.sum / stat.count), stat.max);
+}
+
+static void hist_report(const char *name, U16 ntasks)
+{
+	for (int i = 0; i < BENCH_HIST_BINS; i++)
+	{
+		printf("BENCH_HIST,%s,%u,%u,%u\r\n", name, ntasks, (U32)(i * BENCH_HIST_WIDTH), stat.hist[i]);
+	}
+}
+
+// Create a task with the minimum stack. Returns its TID, or TID_NULL on failure.
+static task_t spawn(void (*ptask)(void *args), int deadline)
+{
+	TCB task = {0};
+	task.stack_size = STACK_SIZE;
+	task.ptask = ptask;
+	if (osCreateDeadlineTask(deadline, &task) != RTX_OK)
+	{
+		return TID_NULL;
+	}
+	return task.tid;
+}
+
+// Sleep until only ntasks tasks, including the controller, are left.
+static void wait_tasks(U16 ntasks)
+{
+	while (kernel_config.num_running_tasks > ntasks)
+	{
+		osSleep(1);
+	}
+}
+
+// Background load: stays READY with a late deadline so it sits in the ready queue but never runs first.
+static void filler_task(void *)
+{
+	while (!filler_stop)
+	{
+		osYield();
+	}
+	osTaskExit();
+}
+
+// The ready scan scheduler() did before the ready queue: every TID below limit, most urgent READY
+// task wins. Compares tasks the same way the queue does.
+static task_t scan_pick(task_t limit)
+{
+	task_t next = TID_NULL;
+	for (task_t i = 1; i < limit; i++)
+	{
+		TCB* tcb = &kernel_config.TCBS[i];
+		if (tcb->state == READY && (next == TID_NULL || k_sched_preempts(tcb, &kernel_config.TCBS[next])))
+		{
+			next = i;
+		}
+	}
+	return next;
+}
+
+// One past the highest TID in use, so the scan walks what a build with just enough MAX_TASKS would.
+static task_t scan_limit(void)
+{
+	task_t limit = 1;
+	for (task_t i = k_tid_map_next(kernel_config.active_tids, 1); i < MAX_TASKS; i = k_tid_map_next(kernel_config.active_tids, i + 1))
+	{
+		limit = i + 1;
+	}
+	return limit;
+}
+
+static void exit_task(void *)
+{
+	osTaskExit();
+}
+
+// Records the time from the controller's bench_mark until it gets the CPU, then hands it back.
+static void partner_task(void *)
+{
+	while (!partner_stop)
+	{
+		U32 now = bench_cycles();
+		if (bench_armed)
+		{
+			stat_record(now - bench_mark);
+			bench_armed = FALSE;
+		}
+		osYieldTo(controller_tid);
+	}
+	osTaskExit();
+}
+
+// Waits in osSleep for the EXTI interrupt to wake it and records the time since the handler was entered.
+static void irq_task(void *)
+{
+	while (1)
+	{
+		osSleep(BENCH_IRQ_TIMEOUT);
+		U32 now = bench_cycles();
+		if (irq_stop)
+		{
+			break;
+		}
+		if (irq_woken)
+		{
+			irq_woken = FALSE;
+			stat_record(now - irq_stamp);
+		}
+	}
+	osTaskExit();
+}
+
+// Raise EXTI line 13 in software. It goes through EXTI and the NVIC like a B1 press would.
+static void irq_trigger(void)
+{
+#if BENCH_IRQ_SOFTWARE
+	EXTI->SWIER = B1_Pin;
+#endif
+}
+
+// Measure every primitive with ntasks tasks alive: the controller and ntasks - 1 fillers.
+static void bench_run(U16 ntasks)
+{
+	filler_stop = FALSE;
+	for (U16 i = 1; i < ntasks; i++)
+	{
+		spawn(&filler_task, BENCH_FILLER_DEADLINE);
+	}
+
+	// Picking the next task with ntasks - 1 READY fillers: the old linear scan against a pop and
+	// re-insert on the ready queue, the queue work of one switch. Both run in a critical section.
+	task_t limit = scan_limit();
+	stat_reset();
+	while (stat.count < BENCH_SAMPLES)
+	{
+		U32 crit = k_crit_enter();
+		U32 start = bench_cycles();
+		picked = scan_pick(limit);
+		stat_record(bench_cycles() - start);
+		k_crit_exit(crit);
+	}
+	stat_report("pick_scan", ntasks);
+
+	stat_reset();
+	while (stat.count < BENCH_SAMPLES)
+	{
+		U32 crit = k_crit_enter();
+		U32 start = bench_cycles();
+		picked = k_sched_pop();
+		if (picked != TID_NULL)
+		{
+			k_sched_insert(&kernel_config.TCBS[picked]);
+		}
+		stat_record(bench_cycles() - start);
+		k_crit_exit(crit);
+	}
+	stat_report("pick_queue", ntasks);
+
+	// osYield back to the caller: PendSV, new_task and a scheduler pass over the ready queue.
+	stat_reset();
+	while (stat.count < BENCH_SAMPLES)
+	{
+		U32 start = bench_cycles();
+		osYield();
+		stat_record(bench_cycles() - start);
+	}
+	stat_report("yield", ntasks);
+
+	// osCreateDeadlineTask of a task that does not preempt the caller. It exits before the next sample.
+	stat_reset();
+	while (stat.count < BENCH_SAMPLES)
+	{
+		U32 start = bench_cycles();
+		spawn(&exit_task, BENCH_FILLER_DEADLINE);
+		stat_record(bench_cycles() - start);
+		wait_tasks(ntasks);
+	}
+	stat_report("create", ntasks);
+
+	partner_stop = FALSE;
+	task_t partner = spawn(&partner_task, BENCH_DEADLINE);
+
+	// osYieldTo the partner: a full switch to another task through the handoff path.
+	stat_reset();
+	while (stat.count < BENCH_SAMPLES)
+	{
+		bench_armed = TRUE;
+		bench_mark = bench_cycles();
+		osYieldTo(partner);
+	}
+	stat_report("yield_to", ntasks);
+
+	// osSleep until the partner runs: timer queue insert plus the switch away from a blocked task.
+	stat_reset();
+	while (stat.count < BENCH_SAMPLES)
+	{
+		bench_armed = TRUE;
+		bench_mark = bench_cycles();
+		osSleep(1);
+	}
+	stat_report("sleep", ntasks);
+
+	partner_stop = TRUE;
+	wait_tasks(ntasks);
+
+	// Interrupt to task: EXTI15_10_IRQHandler entry until the task woken by osWakeFromISR runs.
+	// The woken task has the shortest deadline, so the switch happens on exception return.
+	irq_stop = FALSE;
+	irq_tid = spawn(&irq_task, 1);
+	stat_reset();
+	while (stat.count < BENCH_SAMPLES)
+	{
+		// Let the task go back to sleep before the next interrupt.
+		osSleep(1);
+		irq_trigger();
+	}
+	stat_report("irq_wake", ntasks);
+	hist_report("irq_wake", ntasks);
+	irq_stop = TRUE;
+	irq_trigger();
+
+	filler_stop = TRUE;
+	wait_tasks(1);
+}
+
+static void controller_task(void *)
+{
+	controller_tid = osGetTID();
+	cycles_init();
+
+	// B1 is configured for falling edge interrupts by MX_GPIO_Init, only the NVIC line is left. It
+	// calls osWakeFromISR, so it must not be more urgent than KERNEL_IRQ_PRIORITY.
+	NVIC_SetPriority(EXTI15_10_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+	NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+	printf("BENCH,clock,%s,%u\r\n", use_dwt ? "dwt" : "systick", (U32)SystemCoreClock);
+	printf("BENCH,primitive,tasks,min,avg,max\r\n");
+
+	// Leave room for the partner and the task created by the create benchmark.
+	U16 ntasks = 2;
+	while (1)
+	{
+		if (ntasks > MAX_TASKS - 2)
+		{
+			ntasks = MAX_TASKS - 2;
+		}
+		bench_run(ntasks);
+		if (ntasks == MAX_TASKS - 2)
+		{
+			break;
+		}
+		ntasks *= 2;
+	}
+
+	printf("BENCH,done\r\n");
+	osTaskExit();
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void bench_irq_entry(void)
+{
+	irq_stamp = bench_cycles();
+}
+
+// Called by HAL_GPIO_EXTI_IRQHandler once the EXTI pending bit is cleared.
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	if (GPIO_Pin == B1_Pin && osWakeFromISR(irq_tid) == RTX_OK)
+	{
+		irq_woken = TRUE;
+	}
+}
+
+void bench_start(void)
+{
+	spawn(&controller_task, BENCH_DEADLINE);
+	osKernelStart();
+	while (1);
+}
+
+#endif /* RTX_BENCHMARK */
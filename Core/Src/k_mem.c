@@ -1,12 +1,10 @@
 #include "k_mem.h"
 #include <stdio.h>
-#include "stm32f4xx.h"
 #include <math.h>
 #include "k_task.h"
-
-extern uint32_t _estack;
-extern uint32_t _Min_Stack_Size;
-extern uint32_t _img_end;
+#include "k_crit.h"
+#include "k_trace.h"
+#include "port.h"
 
 
 /************************************************
@@ -16,12 +14,14 @@ extern uint32_t _img_end;
 U32 init_called    = 0;   // Initialization flag
 U8 bitarray[2047]  = {0}; // Buddy system bit array
 metadata *free_list[11];  // Linked list of free blocks
-U32 heap_start;           // Heap starting address
+UPTR heap_start;          // Heap starting address
 
 /************************************************
  *               HELPER FUNCTIONS
  ************************************************/
 
+static void index_to_level_and_pos(const U16 index, U8 *level, U16 *level_pos);
+
 unsigned int integer_log2(unsigned int num)
 {
 	if (num == 0)
@@ -71,10 +71,10 @@ static inline U16 get_buddy_level_level_pos(const U8 level, const U16 level_pos)
 */
 
 // Return bitarray index and level given memory address of a block.
-static U16 addr_to_index(const U32 *const ptr, U8 *level_out)
+static U16 addr_to_index(const void *const ptr, U8 *level_out)
 {
 	// Find the index for the bottom level node (child of desired node)
-	U16 bottom_level_offset = ((U32)ptr - heap_start) / (U32)(1 << 5);
+	U16 bottom_level_offset = ((UPTR)ptr - heap_start) / (U32)(1 << 5);
 	U16 bottom_level_index = (1 << 10) - 1 + bottom_level_offset;
 
 	// Move up the heap until allocated node is found
@@ -98,33 +98,26 @@ static inline U8 index_to_level(const U16 index)
 	return (U8)(integer_log2(index + 1));
 }
 
-// Return level offset given index.
-static U16 index_to_level_pos(const U16 index)
-{
-	U8 level = index_to_level(index);
-	return (U16)(index - (1 << level) + 1);
-}
-
 // Return memory address given index.
-static U32 index_to_addr(const U16 index)
+static UPTR index_to_addr(const U16 index)
 {
 	U8 level;
 	U16 level_pos;
 
 	index_to_level_and_pos(index, &level, &level_pos);
 
-	return heap_start + (U32)(1 << (MAX_LEVEL - level)) * level_pos;
+	return heap_start + (UPTR)(1 << (MAX_LEVEL - level)) * level_pos;
 }
 
 // Return memory address and buddy address without using helper given bitarray index.
-void fast_index_to_addr(const U16 index, U32 **addr, U32 **buddy_addr)
+void fast_index_to_addr(const U16 index, metadata **addr, metadata **buddy_addr)
 {
 	U32 level = integer_log2(index + 1);
 	U32 level_pos = (index - (1 << level) + 1);
 
 	U32 level_offset = 1 << (MAX_LEVEL - level);
-	*addr = heap_start + level_offset * level_pos;
-	*buddy_addr = heap_start + level_offset * (level_pos + 1);
+	*addr = (metadata *)(heap_start + level_offset * level_pos);
+	*buddy_addr = (metadata *)(heap_start + level_offset * (level_pos + 1));
 }
 
 // Return level offset given the index and level for the bitarray.
@@ -140,6 +133,16 @@ static void index_to_level_and_pos(const U16 index, U8 *level, U16 *level_pos)
 	*level_pos = (U16)(index - (1 << *level) + 1);
 }
 
+// Remove the head of a free list. The new head must not point back at the removed node.
+static inline void free_list_pop(int lvl)
+{
+	free_list[lvl] = free_list[lvl]->next;
+	if (free_list[lvl] != NULL)
+	{
+		free_list[lvl]->prev = NULL;
+	}
+}
+
 /*
  * Helper function for the allocation function. If a node of the correct size is not available,
  * this function will split a larger node.
@@ -157,7 +160,7 @@ static void split_node(metadata *parent, int lvl)
 	bitarray[child_index] = 1;
 
 	// Remove the node we are splitting from the free list.
-	free_list[lvl] = free_list[lvl]->next;
+	free_list_pop(lvl);
 	
 	// Get 2 children nodes
 	metadata *child;
@@ -178,16 +181,16 @@ static void split_node(metadata *parent, int lvl)
 	free_list[lvl + 1] = child;
 }
 
-// Return block size for a given level.
-static int level_to_block_size(int level)
+// Return block size for a given level. The block also holds its metadata.
+static U32 level_to_block_size(int level)
 {
-	return (1 << (MAX_LEVEL - level)) + sizeof(metadata);
+	return 1U << (MAX_LEVEL - level);
 }
 
 // Return memory address given the level and offset of a memory block.
-static inline U32 level_level_pos_to_addr(const U8 level, const U16 level_pos)
+static inline UPTR level_level_pos_to_addr(const U8 level, const U16 level_pos)
 {
-	return heap_start + (U32)(1 << (MAX_LEVEL - level)) * level_pos;
+	return heap_start + (UPTR)(1 << (MAX_LEVEL - level)) * level_pos;
 }
 
 /************************************************
@@ -197,7 +200,7 @@ static inline U32 level_level_pos_to_addr(const U8 level, const U16 level_pos)
 int k_mem_init()
 {
 	// Init heap address
-	heap_start = &_img_end;
+	heap_start = (UPTR)port_heap();
 
 	// Return error if init already called
 	if (init_called == 1 || kernel_config.is_running == FALSE)
@@ -207,7 +210,7 @@ int k_mem_init()
 	init_called = 1;
 
 	// Init root node of memory
-	metadata *head = index_to_addr(0);
+	metadata *head = (metadata *)index_to_addr(0);
 	free_list[0] = head;
 
 	head->next = NULL;
@@ -223,7 +226,8 @@ int k_mem_init()
 	return RTX_OK;
 }
 
-void *k_mem_alloc(size_t size)
+// Buddy allocation proper, k_mem_alloc runs it in a critical section.
+static void *mem_alloc(size_t size)
 {
 	// Check to make sure init called and size are greater than 0
 	if (init_called == 0 || size == 0)
@@ -231,11 +235,12 @@ void *k_mem_alloc(size_t size)
 		return NULL;
 	}
 
-	int lvl = MAX_LEVEL;                                 // level variable 
-	int size_of_block_at_lvl = level_to_block_size(lvl); // size of a block at a level of lvl
+	size_t needed = size + sizeof(metadata);             // the block holds the metadata too
+	int lvl = LEAF_LEVEL;                                // level variable 
+	U32 size_of_block_at_lvl = level_to_block_size(lvl); // size of a block at a level of lvl
 
 	// Find the level that can accomodate an allocation of given size.
-	while ((size_of_block_at_lvl < size) && (lvl > 0))
+	while ((size_of_block_at_lvl < needed) && (lvl > 0))
 	{
 		lvl--;
 		size_of_block_at_lvl = level_to_block_size(lvl);
@@ -271,7 +276,7 @@ void *k_mem_alloc(size_t size)
 		}
 
 		// Split the free node down to our desired level
-		for (free_node_lvl; free_node_lvl < lvl; free_node_lvl++)
+		for (; free_node_lvl < lvl; free_node_lvl++)
 		{
 			split_node(free_list[free_node_lvl], free_node_lvl);
 		}
@@ -280,7 +285,7 @@ void *k_mem_alloc(size_t size)
 	U8 *base_address = (U8 *)free_list[lvl];
 
 	// Remove the node we just allocated from the free list
-	free_list[lvl] = free_list[lvl]->next;
+	free_list_pop(lvl);
 
 	// Initialize the metadata for the newly allocated node.
 	metadata *meta = (metadata *)base_address;
@@ -298,7 +303,8 @@ void transfer_memory(void *ptr, task_t tid) {
 	meta->task_tid = tid;
 }
 
-int k_mem_dealloc(void *ptr)
+// Buddy free proper, k_mem_dealloc runs it in a critical section.
+static int mem_dealloc(void *ptr)
 {
 	if (init_called == 0) // Check to make sure init called and size are greater than 0
 	{
@@ -313,6 +319,12 @@ int k_mem_dealloc(void *ptr)
 		return RTX_ERR;
 	}
 
+	// Only an address inside the heap has metadata in front of it to check.
+	if ((UPTR)ptr < heap_start + sizeof(metadata) || (UPTR)ptr >= heap_start + ((UPTR)1 << MAX_LEVEL))
+	{
+		return RTX_ERR;
+	}
+
 	/**
 	 *  Check validity of pointer (random/invalid so check for metadata key value)
 	 */
@@ -357,7 +369,7 @@ int k_mem_dealloc(void *ptr)
 	 *  Coalescing algorithm
 	 **************************/
 
-	U8 current_level = level;
+	U32 current_level = level;
 	U16 current_level_pos = index_level_to_level_pos(bitarray_index, current_level);
 
 	U16 buddy_index = get_buddy_level_level_pos(current_level, current_level_pos);
@@ -424,7 +436,7 @@ int k_mem_dealloc(void *ptr)
 	return RTX_OK;
 }
 
-int k_mem_count_extfrag(size_t size)
+static int mem_count_extfrag(size_t size)
 {
 	// Check to make sure init called and size are greater than 0
 	if ((init_called == 0) || (size == 0) || (size <= 32))
@@ -432,25 +444,45 @@ int k_mem_count_extfrag(size_t size)
 		return 0;
 	}
 
-	int max_level = MAX_LEVEL;                           // level variable 
-	int size_of_block_at_lvl = level_to_block_size(lvl); // size of a block at a level of lvl
-
-	// Find the level that can accomodate an allocation of given size.
-	while ((size_of_block_at_lvl < size) && (lvl > 0))
-	{
-		lvl--;
-		size_of_block_at_lvl = level_to_block_size(lvl);
-	}
-
 	int count = 0;
 
-	// Increment the count for the levels that could accomodate the size.
-	for (int lvl = max_level; lvl <= MAX_LEVEL; ++lvl)
+	// Count the free blocks of every level whose blocks are smaller than size.
+	for (int lvl = LEAF_LEVEL; (lvl >= 0) && (level_to_block_size(lvl) < size); lvl--)
 	{
-		if (free_list[i] != NULL)
+		for (metadata *block = free_list[lvl]; block != NULL; block = block->next)
 		{
 			count++;
 		}
 	}
 	return count;
 }
+
+// The free lists and bit array are shared by every task, so each call is one kernel critical section.
+void *k_mem_alloc(size_t size)
+{
+	U32 crit = k_crit_enter();
+	void *ptr = mem_alloc(size);
+	K_TRACE(TRACE_ALLOC, osGetTID(), ptr);
+	k_crit_exit(crit);
+	return ptr;
+}
+
+int k_mem_dealloc(void *ptr)
+{
+	U32 crit = k_crit_enter();
+	int result = mem_dealloc(ptr);
+	if (result == RTX_OK)
+	{
+		K_TRACE(TRACE_FREE, osGetTID(), ptr);
+	}
+	k_crit_exit(crit);
+	return result;
+}
+
+int k_mem_count_extfrag(size_t size)
+{
+	U32 crit = k_crit_enter();
+	int count = mem_count_extfrag(size);
+	k_crit_exit(crit);
+	return count;
+}
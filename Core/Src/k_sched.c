@@ -0,0 +1,625 @@
+#include "k_sched.h"
+#include "k_task.h"
+#include "common.h"
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#define NOT_QUEUED      0xFFFF  // marks a task that is not in the ready queue
+
+#if SCHED_POLICY == SCHED_EDF
+#define DEMOTED_KEY     (1ULL << 63)  // set in a demoted task's deadline, so it sorts after every other
+#elif SCHED_POLICY == SCHED_RM
+#define PRIORITY_MAP_WORDS  ((PRIORITY_LEVELS + 31) / 32)
+#define DEMOTED_LEVEL   (PRIORITY_LEVELS - 1)  // kept for demoted tasks, others stop one level above
+#endif
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+#if SCHED_POLICY == SCHED_EDF
+
+// Binary min-heap of READY TIDs keyed by deadline. The root is the next task to run.
+static task_t ready_heap[MAX_TASKS];
+static U16 heap_pos[MAX_TASKS];   // index of each TID in ready_heap
+static U16 heap_size;
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// Deadline the task is scheduled by: its own, or an earlier one inherited through a mutex.
+static inline U64 sched_deadline(const TCB *tcb)
+{
+	U64 own = tcb->demoted ? tcb->abs_deadline | DEMOTED_KEY : tcb->abs_deadline;
+	U64 inherited = tcb->inherit_deadline;
+	return inherited != 0 && inherited < own ? inherited : own;
+}
+
+// Return TRUE if the task at heap index a must run before the task at heap index b.
+static inline int heap_before(U16 a, U16 b)
+{
+	return k_sched_preempts(&kernel_config.TCBS[ready_heap[a]], &kernel_config.TCBS[ready_heap[b]]);
+}
+
+// Swap two heap entries and keep the position table in sync.
+static inline void heap_swap(U16 a, U16 b)
+{
+	task_t tmp = ready_heap[a];
+	ready_heap[a] = ready_heap[b];
+	ready_heap[b] = tmp;
+
+	heap_pos[ready_heap[a]] = a;
+	heap_pos[ready_heap[b]] = b;
+}
+
+// Move an entry towards the root until its parent is more urgent.
+static void sift_up(U16 pos)
+{
+	while (pos > 0)
+	{
+		U16 parent = (pos - 1) >> 1;
+		if (!heap_before(pos, parent))
+		{
+			break;
+		}
+		heap_swap(pos, parent);
+		pos = parent;
+	}
+}
+
+// Move an entry towards the leaves until both children are less urgent.
+static void sift_down(U16 pos)
+{
+	while (1)
+	{
+		U16 left = (pos << 1) + 1;
+		U16 right = left + 1;
+		U16 smallest = pos;
+
+		if (left < heap_size && heap_before(left, smallest))
+		{
+			smallest = left;
+		}
+		if (right < heap_size && heap_before(right, smallest))
+		{
+			smallest = right;
+		}
+		if (smallest == pos)
+		{
+			break;
+		}
+		heap_swap(pos, smallest);
+		pos = smallest;
+	}
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void k_sched_assign(TCB *tcb)
+{
+	// EDF orders by absolute deadline, there is no fixed priority to derive.
+	tcb->priority = 0;
+}
+
+void k_sched_init(void)
+{
+	heap_size = 0;
+	for (int i = 0; i < MAX_TASKS; i++)
+	{
+		heap_pos[i] = NOT_QUEUED;
+	}
+}
+
+int k_sched_preempts(const TCB *a, const TCB *b)
+{
+	U64 deadline_a = sched_deadline(a);
+	U64 deadline_b = sched_deadline(b);
+	if (deadline_a != deadline_b)
+	{
+		return deadline_a < deadline_b;
+	}
+	return a->tid < b->tid;
+}
+
+int k_sched_more_urgent(const TCB *a, const TCB *b)
+{
+	return sched_deadline(a) < sched_deadline(b);
+}
+
+void k_sched_inherit(TCB *owner, const TCB *waiter)
+{
+	U64 deadline = sched_deadline(waiter);
+	if (owner->inherit_deadline == 0 || deadline < owner->inherit_deadline)
+	{
+		owner->inherit_deadline = deadline;
+		k_sched_update(owner);
+	}
+}
+
+void k_sched_inherit_reset(TCB *tcb)
+{
+	tcb->inherit_deadline = 0;
+	k_sched_update(tcb);
+}
+
+void k_sched_insert(TCB *tcb)
+{
+	task_t tid = tcb->tid;
+	if (tid == TID_NULL || heap_pos[tid] != NOT_QUEUED)
+	{
+		return;
+	}
+
+	ready_heap[heap_size] = tid;
+	heap_pos[tid] = heap_size;
+	heap_size++;
+	sift_up(heap_pos[tid]);
+}
+
+void k_sched_remove(TCB *tcb)
+{
+	task_t tid = tcb->tid;
+	if (tid >= MAX_TASKS || heap_pos[tid] == NOT_QUEUED)
+	{
+		return;
+	}
+
+	U16 pos = heap_pos[tid];
+	heap_size--;
+	heap_pos[tid] = NOT_QUEUED;
+
+	if (pos == heap_size)
+	{
+		return;
+	}
+
+	// Fill the hole with the last entry and restore the heap property in whichever direction it is broken.
+	task_t moved = ready_heap[heap_size];
+	ready_heap[pos] = moved;
+	heap_pos[moved] = pos;
+	sift_up(pos);
+	sift_down(heap_pos[moved]);
+}
+
+void k_sched_update(TCB *tcb)
+{
+	task_t tid = tcb->tid;
+	if (tid >= MAX_TASKS || heap_pos[tid] == NOT_QUEUED)
+	{
+		return;
+	}
+
+	sift_up(heap_pos[tid]);
+	sift_down(heap_pos[tid]);
+}
+
+task_t k_sched_peek(void)
+{
+	if (heap_size == 0)
+	{
+		return TID_NULL;
+	}
+	return ready_heap[0];
+}
+
+#elif SCHED_POLICY == SCHED_RM
+
+// One FIFO list of READY TIDs per priority level, linked through these tables.
+static U16 level_head[PRIORITY_LEVELS];
+static U16 level_tail[PRIORITY_LEVELS];
+static U16 ready_next[MAX_TASKS];
+static U16 ready_prev[MAX_TASKS];
+static U8 queued_level[MAX_TASKS];  // level a TID is queued on, valid when queued
+static U8 is_queued[MAX_TASKS];
+
+// Set bit (31 - level % 32) of word level / 32 marks a non-empty level, so CLZ finds the most urgent.
+static U32 level_map[PRIORITY_MAP_WORDS];
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// Priority the task is scheduled at: its own, or a more urgent one inherited through a mutex.
+static inline U8 sched_priority(const TCB *tcb)
+{
+	return tcb->inherit_priority < tcb->priority ? tcb->inherit_priority : tcb->priority;
+}
+
+// Append a TID to the tail of its priority level.
+static void level_push(task_t tid, U32 level)
+{
+	ready_next[tid] = NOT_QUEUED;
+	ready_prev[tid] = level_tail[level];
+
+	if (level_tail[level] != NOT_QUEUED)
+	{
+		ready_next[level_tail[level]] = tid;
+	}
+	else
+	{
+		level_head[level] = tid;
+		level_map[level >> 5] |= 0x80000000U >> (level & 31);
+	}
+	level_tail[level] = tid;
+
+	queued_level[tid] = level;
+	is_queued[tid] = TRUE;
+}
+
+// Unlink a TID from the level it is queued on.
+static void level_unlink(task_t tid)
+{
+	U32 level = queued_level[tid];
+
+	if (ready_prev[tid] != NOT_QUEUED)
+	{
+		ready_next[ready_prev[tid]] = ready_next[tid];
+	}
+	else
+	{
+		level_head[level] = ready_next[tid];
+	}
+	if (ready_next[tid] != NOT_QUEUED)
+	{
+		ready_prev[ready_next[tid]] = ready_prev[tid];
+	}
+	else
+	{
+		level_tail[level] = ready_prev[tid];
+	}
+
+	if (level_head[level] == NOT_QUEUED)
+	{
+		level_map[level >> 5] &= ~(0x80000000U >> (level & 31));
+	}
+	is_queued[tid] = FALSE;
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void k_sched_assign(TCB *tcb)
+{
+	// Deadline monotonic: exact levels for deadlines below 8 ticks, then four levels per
+	// doubling of the deadline. Tasks that land on the same level run in FIFO order.
+	U32 deadline = tcb->deadline > 0 ? tcb->deadline : 1;
+	U32 exponent = 31 - __builtin_clz(deadline);
+	U32 level;
+
+	if (exponent < 3)
+	{
+		level = deadline - 1;
+	}
+	else
+	{
+		level = 7 + ((exponent - 3) << 2) + ((deadline >> (exponent - 2)) & 3);
+	}
+
+	tcb->priority = level < DEMOTED_LEVEL ? level : DEMOTED_LEVEL - 1;
+	if (tcb->demoted)
+	{
+		tcb->priority = DEMOTED_LEVEL;
+	}
+}
+
+void k_sched_init(void)
+{
+	for (int i = 0; i < PRIORITY_LEVELS; i++)
+	{
+		level_head[i] = NOT_QUEUED;
+		level_tail[i] = NOT_QUEUED;
+	}
+	for (int i = 0; i < PRIORITY_MAP_WORDS; i++)
+	{
+		level_map[i] = 0;
+	}
+	for (int i = 0; i < MAX_TASKS; i++)
+	{
+		is_queued[i] = FALSE;
+	}
+}
+
+int k_sched_preempts(const TCB *a, const TCB *b)
+{
+	// Equal priorities never preempt each other.
+	return sched_priority(a) < sched_priority(b);
+}
+
+int k_sched_more_urgent(const TCB *a, const TCB *b)
+{
+	return k_sched_preempts(a, b);
+}
+
+void k_sched_insert(TCB *tcb)
+{
+	task_t tid = tcb->tid;
+	if (tid == TID_NULL || is_queued[tid])
+	{
+		return;
+	}
+
+	level_push(tid, sched_priority(tcb));
+}
+
+void k_sched_remove(TCB *tcb)
+{
+	task_t tid = tcb->tid;
+	if (tid >= MAX_TASKS || !is_queued[tid])
+	{
+		return;
+	}
+
+	level_unlink(tid);
+}
+
+void k_sched_update(TCB *tcb)
+{
+	task_t tid = tcb->tid;
+
+	// Deadline renewals leave a fixed priority unchanged, only osSetDeadline and inheritance move a task.
+	if (tid >= MAX_TASKS || !is_queued[tid] || queued_level[tid] == sched_priority(tcb))
+	{
+		return;
+	}
+
+	level_unlink(tid);
+	level_push(tid, sched_priority(tcb));
+}
+
+void k_sched_inherit(TCB *owner, const TCB *waiter)
+{
+	U8 priority = sched_priority(waiter);
+	if (priority < owner->inherit_priority)
+	{
+		owner->inherit_priority = priority;
+		k_sched_update(owner);
+	}
+}
+
+void k_sched_inherit_reset(TCB *tcb)
+{
+	tcb->inherit_priority = PRIORITY_LEVELS;
+	k_sched_update(tcb);
+}
+
+task_t k_sched_peek(void)
+{
+	for (int i = 0; i < PRIORITY_MAP_WORDS; i++)
+	{
+		if (level_map[i] != 0)
+		{
+			return level_head[(i << 5) + __builtin_clz(level_map[i])];
+		}
+	}
+	return TID_NULL;
+}
+
+#else
+#error "Unknown SCHED_POLICY"
+#endif
+
+task_t k_sched_pop(void)
+{
+	task_t tid = k_sched_peek();
+	if (tid != TID_NULL)
+	{
+		k_sched_remove(&kernel_config.TCBS[tid]);
+	}
+	return tid;
+}
+
+/************************************************
+ *               ADMISSION CONTROL
+ ************************************************/
+
+// Iterate over the active tasks that declared a wcet and are not demoted. The candidate is not active yet.
+#define FOR_EACH_ADMITTED(tcb) \
+	for (task_t _i = k_tid_map_next(kernel_config.active_tids, 1); _i < MAX_TASKS; _i = k_tid_map_next(kernel_config.active_tids, _i + 1)) \
+		if (((tcb) = &kernel_config.TCBS[_i])->wcet != 0 && !(tcb)->demoted)
+
+U32 k_sched_utilization(const TCB *tcb)
+{
+	if (tcb->wcet == 0 || tcb->period == 0 || tcb->demoted)
+	{
+		return 0;
+	}
+	return (U32)(((U64)tcb->wcet * UTIL_FULL + tcb->period - 1) / tcb->period);
+}
+
+#if SCHED_POLICY == SCHED_EDF
+
+// Demand of one task's jobs that are both released and due in [0, t].
+static inline U64 task_demand(const TCB *tcb, U64 t)
+{
+	if (t < tcb->deadline)
+	{
+		return 0;
+	}
+	return ((t - tcb->deadline) / tcb->period + 1) * tcb->wcet;
+}
+
+// Processor demand of the admitted tasks plus the candidate over [0, t].
+static U64 total_demand(const TCB *candidate, U64 t)
+{
+	const TCB *tcb;
+	U64 demand = task_demand(candidate, t);
+
+	FOR_EACH_ADMITTED(tcb)
+	{
+		demand += task_demand(tcb, t);
+	}
+	return demand;
+}
+
+// Sufficient test used when the demand test would need too many points: sum of wcet / deadline <= 1.
+static int density_test(const TCB *candidate)
+{
+	const TCB *tcb;
+	U64 density = ((U64)candidate->wcet * UTIL_FULL + candidate->deadline - 1) / candidate->deadline;
+
+	FOR_EACH_ADMITTED(tcb)
+	{
+		density += ((U64)tcb->wcet * UTIL_FULL + tcb->deadline - 1) / tcb->deadline;
+	}
+	return density <= UTIL_FULL ? RTX_OK : RTX_ERR;
+}
+
+// Check demand(t) <= t at every absolute deadline of one task up to the bound.
+static int check_deadlines(const TCB *candidate, const TCB *tcb, U64 bound, U32 *points)
+{
+	for (U64 t = tcb->deadline; t <= bound; t += tcb->period)
+	{
+		if (++(*points) > ADMISSION_MAX_POINTS)
+		{
+			return density_test(candidate);
+		}
+		if (total_demand(candidate, t) > t)
+		{
+			return RTX_ERR;
+		}
+	}
+	return RTX_OK;
+}
+
+int k_sched_admit(const TCB *candidate)
+{
+	const TCB *tcb;
+
+	if (candidate->wcet == 0)
+	{
+		return RTX_OK;
+	}
+	if (candidate->wcet > candidate->deadline)
+	{
+		return RTX_ERR;
+	}
+
+	U32 utilization = kernel_config.utilization + k_sched_utilization(candidate);
+	if (utilization > UTIL_FULL)
+	{
+		return RTX_ERR;
+	}
+
+	// With implicit deadlines everywhere the utilization bound is exact.
+	int constrained = candidate->deadline < candidate->period;
+	U32 max_deadline = candidate->deadline;
+	U64 slack = (U64)(candidate->period - candidate->deadline) * k_sched_utilization(candidate);
+
+	FOR_EACH_ADMITTED(tcb)
+	{
+		constrained |= tcb->deadline < tcb->period;
+		max_deadline = tcb->deadline > max_deadline ? tcb->deadline : max_deadline;
+		slack += (U64)(tcb->period - tcb->deadline) * k_sched_utilization(tcb);
+	}
+	if (!constrained)
+	{
+		return RTX_OK;
+	}
+	if (utilization == UTIL_FULL)
+	{
+		// No finite demand bound, fall back to the sufficient test.
+		return density_test(candidate);
+	}
+
+	// Demand can only exceed supply before L = max(D_max, sum((T_i - D_i) * U_i) / (1 - U)).
+	U64 bound = (slack + (UTIL_FULL - utilization) - 1) / (UTIL_FULL - utilization);
+	if (bound < max_deadline)
+	{
+		bound = max_deadline;
+	}
+
+	U32 points = 0;
+	if (check_deadlines(candidate, candidate, bound, &points) != RTX_OK)
+	{
+		return RTX_ERR;
+	}
+	FOR_EACH_ADMITTED(tcb)
+	{
+		if (points > ADMISSION_MAX_POINTS)
+		{
+			break;
+		}
+		if (check_deadlines(candidate, tcb, bound, &points) != RTX_OK)
+		{
+			return RTX_ERR;
+		}
+	}
+	return RTX_OK;
+}
+
+#elif SCHED_POLICY == SCHED_RM
+
+// Interference on a task from jobs of one equal or higher priority task released in a window.
+static inline U64 interference(const TCB *tcb, U64 window)
+{
+	return ((window + tcb->period - 1) / tcb->period) * tcb->wcet;
+}
+
+// Response time analysis for one task. Tasks sharing its priority level count as interference.
+static int response_time_ok(const TCB *candidate, const TCB *task)
+{
+	const TCB *tcb;
+	U64 response = task->wcet;
+
+	while (1)
+	{
+		U64 next = task->wcet;
+		if (candidate != task && candidate->priority <= task->priority)
+		{
+			next += interference(candidate, response);
+		}
+		FOR_EACH_ADMITTED(tcb)
+		{
+			if (tcb != task && tcb->priority <= task->priority)
+			{
+				next += interference(tcb, response);
+			}
+		}
+
+		if (next > task->deadline)
+		{
+			return RTX_ERR;
+		}
+		if (next == response)
+		{
+			return RTX_OK;
+		}
+		response = next;
+	}
+}
+
+int k_sched_admit(const TCB *candidate)
+{
+	const TCB *tcb;
+
+	if (candidate->wcet == 0)
+	{
+		return RTX_OK;
+	}
+	if (kernel_config.utilization + k_sched_utilization(candidate) > UTIL_FULL)
+	{
+		return RTX_ERR;
+	}
+
+	// Only the candidate and the tasks it can delay need to be checked.
+	if (response_time_ok(candidate, candidate) != RTX_OK)
+	{
+		return RTX_ERR;
+	}
+	FOR_EACH_ADMITTED(tcb)
+	{
+		if (tcb->priority >= candidate->priority && response_time_ok(candidate, tcb) != RTX_OK)
+		{
+			return RTX_ERR;
+		}
+	}
+	return RTX_OK;
+}
+
+#endif
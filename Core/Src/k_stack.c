@@ -0,0 +1,114 @@
+#include "k_stack.h"
+#include "k_crit.h"
+#include "k_task.h"
+#include "common.h"
+#include <stddef.h>
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#define STACK_POOL_CLASSES  3
+#define STACK_POOL_SLOTS    (STACK_POOL_COUNT_0 + STACK_POOL_COUNT_1 + STACK_POOL_COUNT_2)
+#define STACK_POOL_BYTES    (STACK_POOL_SIZE_0 * STACK_POOL_COUNT_0 + STACK_POOL_SIZE_1 * STACK_POOL_COUNT_1 + \
+                             STACK_POOL_SIZE_2 * STACK_POOL_COUNT_2)
+#define SLOT_NONE           0xFFFF  //end of a free list
+#define SLOT_USED           0xFFFE  //next_free value of an allocated slot
+
+#if STACK_POOL_SLOTS >= SLOT_USED
+#error "too many stacks in the pool"
+#endif
+
+typedef struct stack_class_t {
+	U8* base;   //first stack of the class
+	U16 size;   //bytes per stack
+	U16 count;  //stacks in the class
+	U16 first;  //slot number of the first stack
+	U16 head;   //first free slot, SLOT_NONE if the class is used up
+}STACK_CLASS;
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+// Stacks, smallest class first. Every size is a multiple of 32, so every stack is 32-byte aligned.
+static U8 stack_pool[STACK_POOL_BYTES] __attribute__((aligned(32)));
+
+static STACK_CLASS classes[STACK_POOL_CLASSES] = {
+	{stack_pool, STACK_POOL_SIZE_0, STACK_POOL_COUNT_0, 0, SLOT_NONE},
+	{stack_pool + STACK_POOL_SIZE_0 * STACK_POOL_COUNT_0, STACK_POOL_SIZE_1, STACK_POOL_COUNT_1,
+	 STACK_POOL_COUNT_0, SLOT_NONE},
+	{stack_pool + STACK_POOL_SIZE_0 * STACK_POOL_COUNT_0 + STACK_POOL_SIZE_1 * STACK_POOL_COUNT_1,
+	 STACK_POOL_SIZE_2, STACK_POOL_COUNT_2, STACK_POOL_COUNT_0 + STACK_POOL_COUNT_1, SLOT_NONE},
+};
+
+// Free lists are linked through this table rather than the stacks, by slot number.
+static U16 next_free[STACK_POOL_SLOTS];
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void k_stack_init(void)
+{
+	for (int c = 0; c < STACK_POOL_CLASSES; c++)
+	{
+		STACK_CLASS* class = &classes[c];
+		class->head = class->count > 0 ? class->first : SLOT_NONE;
+		for (U16 i = 0; i < class->count; i++)
+		{
+			next_free[class->first + i] = i + 1 < class->count ? class->first + i + 1 : SLOT_NONE;
+		}
+	}
+}
+
+U32* k_stack_alloc(U16* size)
+{
+	U32 crit = k_crit_enter();
+	for (int c = 0; c < STACK_POOL_CLASSES; c++)
+	{
+		STACK_CLASS* class = &classes[c];
+		if (class->size < *size || class->head == SLOT_NONE)
+		{
+			continue;
+		}
+
+		U16 slot = class->head;
+		class->head = next_free[slot];
+		next_free[slot] = SLOT_USED;
+		k_crit_exit(crit);
+
+		*size = class->size;
+		return (U32*)(class->base + (U32)(slot - class->first) * class->size);
+	}
+	k_crit_exit(crit);
+	return NULL;
+}
+
+int k_stack_free(U32* stack)
+{
+	U8* addr = (U8*)stack;
+	for (int c = 0; c < STACK_POOL_CLASSES; c++)
+	{
+		STACK_CLASS* class = &classes[c];
+		U8* end = class->base + (U32)class->count * class->size;
+		if (addr < class->base || addr >= end)
+		{
+			continue;
+		}
+
+		U32 offset = (U32)(addr - class->base);
+		U16 slot = class->first + offset / class->size;
+		U32 crit = k_crit_enter();
+		if (offset % class->size != 0 || next_free[slot] != SLOT_USED)
+		{
+			k_crit_exit(crit);
+			return RTX_ERR;
+		}
+		next_free[slot] = class->head;
+		class->head = slot;
+		k_crit_exit(crit);
+		return RTX_OK;
+	}
+	return RTX_ERR;
+}
@@ -0,0 +1,64 @@
+#include "k_stats.h"
+#include "k_crit.h"
+#include "k_task.h"
+#include "common.h"
+#include "port.h"
+#include <stddef.h>
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void k_stats_init(void)
+{
+	kernel_config.switch_stamp = port_cycles();
+	kernel_config.load_stamp = kernel_config.switch_stamp;
+	kernel_config.load_window_end = kernel_config.tick_count + CPU_LOAD_WINDOW;
+}
+
+void k_stats_tick(void)
+{
+	if (kernel_config.tick_count < kernel_config.load_window_end)
+	{
+		return;
+	}
+	kernel_config.load_window_end = kernel_config.tick_count + CPU_LOAD_WINDOW;
+
+	// Charge the running task up to the end of the window.
+	U32 now = port_cycles();
+	kernel_config.TCBS[kernel_config.running_task].run_cycles += now - kernel_config.switch_stamp;
+	kernel_config.switch_stamp = now;
+
+	U32 window = now - kernel_config.load_stamp;
+	kernel_config.load_stamp = now;
+	if (window == 0)
+	{
+		return;
+	}
+
+	// The null task is always active, its share is the idle time.
+	for (task_t tid = k_tid_map_next(kernel_config.active_tids, TID_NULL); tid < MAX_TASKS; tid = k_tid_map_next(kernel_config.active_tids, tid + 1))
+	{
+		TCB *tcb = &kernel_config.TCBS[tid];
+		tcb->cpu_load = (U32)((tcb->run_cycles - tcb->load_base) * UTIL_FULL / window);
+		tcb->load_base = tcb->run_cycles;
+	}
+}
+
+int osGetCpuLoad(U32 *loads)
+{
+	if (loads == NULL)
+	{
+		return RTX_ERR;
+	}
+
+	U32 crit = k_crit_enter();
+	for (task_t tid = 0; tid < MAX_TASKS; tid++)
+	{
+		U8 active = (kernel_config.active_tids[tid >> 5] & TID_MAP_BIT(tid)) != 0;
+		loads[tid] = active ? kernel_config.TCBS[tid].cpu_load : 0;
+	}
+	k_crit_exit(crit);
+
+	return RTX_OK;
+}
@@ -0,0 +1,349 @@
+#include "k_sync.h"
+#include "k_sched.h"
+#include "k_crit.h"
+#include "k_trace.h"
+#include "port.h"
+#include "k_task.h"
+#include "common.h"
+#include <stddef.h>
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// Queue a task behind every waiter at least as urgent.
+static void wait_insert(TCB** queue, TCB* tcb)
+{
+	TCB** link = queue;
+	while (*link != NULL && !k_sched_preempts(tcb, *link))
+	{
+		link = &(*link)->wait_next;
+	}
+	tcb->wait_next = *link;
+	tcb->wait_queue = queue;
+	*link = tcb;
+}
+
+static void wait_remove(TCB* tcb)
+{
+	TCB** link = tcb->wait_queue;
+	while (*link != tcb)
+	{
+		link = &(*link)->wait_next;
+	}
+	*link = tcb->wait_next;
+	tcb->wait_next = NULL;
+	tcb->wait_queue = NULL;
+}
+
+// Make a task taken off a wait queue READY. reason is the TRACE_WAKE arg.
+static void wake(TCB* tcb, U32 reason)
+{
+	tcb->state = READY;
+	k_sched_insert(tcb);
+	K_TRACE(TRACE_WAKE, tcb->tid, reason);
+}
+
+static void held_remove(TCB* owner, MUTEX* mutex)
+{
+	MUTEX** link = &owner->held;
+	while (*link != mutex)
+	{
+		link = &(*link)->next_held;
+	}
+	*link = mutex->next_held;
+	mutex->next_held = NULL;
+}
+
+static void take(MUTEX* mutex, TCB* tcb)
+{
+	mutex->owner = tcb;
+	mutex->next_held = tcb->held;
+	tcb->held = mutex;
+}
+
+// TRUE if the owner of the mutex is, through the mutexes the owners wait on, waiting on tcb.
+static int would_deadlock(const MUTEX* mutex, const TCB* tcb)
+{
+	for (const TCB* owner = mutex->owner; owner != NULL; owner = owner->blocked_on ? owner->blocked_on->owner : NULL)
+	{
+		if (owner == tcb)
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+// The owner inherits from its most urgent waiter. An owner that is itself blocked passes it on.
+static void inherit_chain(MUTEX* mutex)
+{
+	while (mutex != NULL && mutex->owner != NULL && mutex->waiters != NULL)
+	{
+		TCB* owner = mutex->owner;
+		k_sched_inherit(owner, mutex->waiters);
+		if (owner->state != BLOCKED)
+		{
+			return;
+		}
+		// Its place in the queue it waits in may have moved up. A semaphore has no owner to pass it to.
+		TCB** queue = owner->wait_queue;
+		wait_remove(owner);
+		wait_insert(queue, owner);
+		mutex = owner->blocked_on;
+	}
+}
+
+// Recompute what a task inherits from the mutexes it still holds.
+static void inherit_recompute(TCB* tcb)
+{
+	k_sched_inherit_reset(tcb);
+	for (MUTEX* mutex = tcb->held; mutex != NULL; mutex = mutex->next_held)
+	{
+		if (mutex->waiters != NULL)
+		{
+			k_sched_inherit(tcb, mutex->waiters);
+		}
+	}
+}
+
+// Release a mutex its owner no longer holds to the head waiter. Returns the new owner, or NULL.
+static TCB* handoff(MUTEX* mutex)
+{
+	TCB* next = mutex->waiters;
+	mutex->owner = NULL;
+	if (next == NULL)
+	{
+		return NULL;
+	}
+
+	wait_remove(next);
+	next->blocked_on = NULL;
+	take(mutex, next);
+	if (mutex->waiters != NULL)
+	{
+		k_sched_inherit(next, mutex->waiters);
+	}
+	wake(next, 2);
+	return next;
+}
+
+// Hand one unit straight to the head waiter, or add it to the count. Returns the woken task, NULL if
+// the count went up instead, or sets *status to RTX_ERR if the count is already at its maximum.
+static TCB* sem_release(SEMAPHORE* sem, int* status)
+{
+	*status = RTX_OK;
+	TCB* next = sem->waiters;
+	if (next == NULL)
+	{
+		if (sem->count < sem->max)
+		{
+			sem->count++;
+		}
+		else
+		{
+			*status = RTX_ERR;
+		}
+		return NULL;
+	}
+
+	wait_remove(next);
+	wake(next, 3);
+	return next;
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+int osMutexInit(MUTEX* mutex)
+{
+	if (mutex == NULL)
+	{
+		return RTX_ERR;
+	}
+	mutex->owner = NULL;
+	mutex->waiters = NULL;
+	mutex->next_held = NULL;
+	return RTX_OK;
+}
+
+int osMutexLock(MUTEX* mutex)
+{
+	if (mutex == NULL || kernel_config.is_running == FALSE || kernel_config.running_task == TID_DORMANT)
+	{
+		return RTX_ERR;
+	}
+
+	U32 crit = k_crit_enter();
+	TCB* self = &kernel_config.TCBS[kernel_config.running_task];
+	if (mutex->owner == NULL)
+	{
+		take(mutex, self);
+		k_crit_exit(crit);
+		return RTX_OK;
+	}
+	// The null task must stay READY, it is what runs when everything else waits.
+	if (kernel_config.running_task == TID_NULL || would_deadlock(mutex, self))
+	{
+		k_crit_exit(crit);
+		return RTX_ERR;
+	}
+
+	// Block until osMutexUnlock hands the mutex over. The job's deadline keeps running meanwhile.
+	self->state = BLOCKED;
+	self->blocked_on = mutex;
+	wait_insert(&mutex->waiters, self);
+	inherit_chain(mutex);
+	K_TRACE(TRACE_BLOCK, self->tid, mutex->owner->tid);
+	ContextSwitch();
+	k_crit_exit(crit);
+
+	return RTX_OK;
+}
+
+int osMutexUnlock(MUTEX* mutex)
+{
+	if (mutex == NULL || kernel_config.is_running == FALSE || kernel_config.running_task == TID_DORMANT)
+	{
+		return RTX_ERR;
+	}
+
+	U32 crit = k_crit_enter();
+	TCB* self = &kernel_config.TCBS[kernel_config.running_task];
+	if (mutex->owner != self)
+	{
+		k_crit_exit(crit);
+		return RTX_ERR;
+	}
+
+	held_remove(self, mutex);
+	handoff(mutex);
+	inherit_recompute(self);
+
+	// The new owner, or a task only held off by what this one inherited, may now come first.
+	task_t next = k_sched_peek();
+	if (next != TID_NULL && k_sched_preempts(&kernel_config.TCBS[next], self))
+	{
+		ContextSwitch();
+	}
+	k_crit_exit(crit);
+
+	return RTX_OK;
+}
+
+void k_sync_release_all(TCB* tcb)
+{
+	while (tcb->held != NULL)
+	{
+		MUTEX* mutex = tcb->held;
+		held_remove(tcb, mutex);
+		handoff(mutex);
+	}
+	k_sched_inherit_reset(tcb);
+}
+
+void k_sync_requeue(TCB* tcb)
+{
+	// The owner may lose urgency as well as gain it, so recompute what it inherits rather than raise it.
+	while (tcb->state == BLOCKED)
+	{
+		TCB** queue = tcb->wait_queue;
+		wait_remove(tcb);
+		wait_insert(queue, tcb);
+		MUTEX* mutex = tcb->blocked_on;
+		if (mutex == NULL || mutex->owner == NULL)
+		{
+			return;
+		}
+		tcb = mutex->owner;
+		inherit_recompute(tcb);
+	}
+}
+
+int osSemInit(SEMAPHORE* sem, U32 count, U32 max)
+{
+	if (sem == NULL || max == 0 || count > max)
+	{
+		return RTX_ERR;
+	}
+	sem->count = count;
+	sem->max = max;
+	sem->waiters = NULL;
+	return RTX_OK;
+}
+
+int osSemTake(SEMAPHORE* sem)
+{
+	if (sem == NULL || kernel_config.is_running == FALSE || kernel_config.running_task == TID_DORMANT)
+	{
+		return RTX_ERR;
+	}
+
+	U32 crit = k_crit_enter();
+	if (sem->count > 0)
+	{
+		sem->count--;
+		k_crit_exit(crit);
+		return RTX_OK;
+	}
+	// The null task must stay READY, it is what runs when everything else waits.
+	if (kernel_config.running_task == TID_NULL)
+	{
+		k_crit_exit(crit);
+		return RTX_ERR;
+	}
+
+	// Block until a give hands a unit over. The count never goes up while tasks wait.
+	TCB* self = &kernel_config.TCBS[kernel_config.running_task];
+	self->state = BLOCKED;
+	wait_insert(&sem->waiters, self);
+	K_TRACE(TRACE_BLOCK, self->tid, TID_NULL);
+	ContextSwitch();
+	k_crit_exit(crit);
+
+	return RTX_OK;
+}
+
+int osSemGive(SEMAPHORE* sem)
+{
+	if (sem == NULL || kernel_config.is_running == FALSE || kernel_config.running_task == TID_DORMANT)
+	{
+		return RTX_ERR;
+	}
+
+	int status;
+	U32 crit = k_crit_enter();
+	TCB* next = sem_release(sem, &status);
+	if (next != NULL && k_sched_preempts(next, &kernel_config.TCBS[kernel_config.running_task]))
+	{
+		ContextSwitch();
+	}
+	k_crit_exit(crit);
+
+	return status;
+}
+
+int osSemGiveFromISR(SEMAPHORE* sem)
+{
+	if (sem == NULL)
+	{
+		return RTX_ERR;
+	}
+
+	// The caller may have preempted SysTick or another kernel-aware interrupt.
+	int status;
+	U32 crit = k_crit_enter();
+	TCB* next = sem_release(sem, &status);
+
+	// Switch on exception return if the woken task should run now. The null task always yields. A
+	// waiter means the kernel is running, so running_task is only read once there is one.
+	if (next != NULL && (kernel_config.running_task == TID_NULL ||
+	                     k_sched_preempts(next, &kernel_config.TCBS[kernel_config.running_task])))
+	{
+		port_pend_switch();
+	}
+	k_crit_exit(crit);
+
+	return status;
+}
@@ -0,0 +1,269 @@
+#include "k_syscall.h"
+#include "k_task.h"
+#include "k_mem.h"
+#include "k_sync.h"
+#include "port.h"
+#include "common.h"
+#include "stm32f4xx.h"
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+// A syscall takes the caller's stacked R0-R3 and returns the value for its stacked R0.
+typedef U32 (*svc_fn)(U32 *args);
+
+extern void os_kernel_start(void);
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+static U8 kernel_started; //TRUE once SVC_KERNEL_START has run the first task
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// CONTROL.nPRIV is the privilege of thread mode, which made the call.
+static inline int caller_privileged(void)
+{
+	return (__get_CONTROL() & CONTROL_nPRIV_Msk) == 0;
+}
+
+// TRUE if the kernel may use size bytes at ptr for the caller. An unprivileged caller may only pass
+// memory it could write itself, so a bad pointer fails the call instead of faulting in handler mode.
+static inline int caller_memory(const void *ptr, U32 size)
+{
+	return caller_privileged() || port_user_access(ptr, size);
+}
+
+// Only main, before the first task runs, or code that is privileged already may raise privilege.
+static U32 svc_privileged(U32 *args)
+{
+	if (kernel_started && !caller_privileged())
+	{
+		return (U32)RTX_ERR;
+	}
+	__set_CONTROL(__get_CONTROL() & ~CONTROL_nPRIV_Msk);
+	return RTX_OK;
+}
+
+// Does not return here, os_kernel_start (lab1.s) returns from the exception into the first task.
+static U32 svc_kernel_start(U32 *args)
+{
+	if (kernel_started)
+	{
+		return (U32)RTX_ERR;
+	}
+	kernel_started = TRUE;
+	os_kernel_start();
+	return RTX_OK;
+}
+
+static U32 svc_create_task(U32 *args)
+{
+	if (!caller_memory((TCB*)args[0], sizeof(TCB)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osCreateTask((TCB*)args[0]);
+}
+
+static U32 svc_create_deadline_task(U32 *args)
+{
+	if (!caller_memory((TCB*)args[1], sizeof(TCB)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osCreateDeadlineTask((int)args[0], (TCB*)args[1]);
+}
+
+static U32 svc_create_periodic_task(U32 *args)
+{
+	if (!caller_memory((TCB*)args[2], sizeof(TCB)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osCreatePeriodicTask((int)args[0], (int)args[1], (TCB*)args[2]);
+}
+
+#if SCHED_POLICY == SCHED_EDF
+static U32 svc_create_server_task(U32 *args)
+{
+	if (!caller_memory((TCB*)args[2], sizeof(TCB)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osCreateServerTask((int)args[0], (int)args[1], (TCB*)args[2]);
+}
+#endif
+
+// Calls that switch tasks only pend PendSV. It tail-chains once this handler returns.
+static U32 svc_yield(U32 *args)
+{
+	osYield();
+	return RTX_OK;
+}
+
+static U32 svc_yield_to(U32 *args)
+{
+	return (U32)osYieldTo((task_t)args[0]);
+}
+
+static U32 svc_period_yield(U32 *args)
+{
+	osPeriodYield();
+	return RTX_OK;
+}
+
+static U32 svc_sleep(U32 *args)
+{
+	osSleep((int)args[0]);
+	return RTX_OK;
+}
+
+static U32 svc_task_exit(U32 *args)
+{
+	return (U32)osTaskExit();
+}
+
+static U32 svc_task_info(U32 *args)
+{
+	if (!caller_memory((TCB*)args[1], sizeof(TCB)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osTaskInfo((task_t)args[0], (TCB*)args[1]);
+}
+
+static U32 svc_get_tid(U32 *args)
+{
+	return (U32)osGetTID();
+}
+
+static U32 svc_set_deadline(U32 *args)
+{
+	return (U32)osSetDeadline((int)args[0], (task_t)args[1]);
+}
+
+// The miss handler runs privileged in the SysTick handler, so only privileged callers may set one.
+static U32 svc_set_miss_policy(U32 *args)
+{
+	if ((int)args[1] == MISS_POLICY_CALLBACK && !caller_privileged())
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osSetMissPolicy((task_t)args[0], (int)args[1], (void (*)(task_t))args[2]);
+}
+
+static U32 svc_free_utilization(U32 *args)
+{
+	return osGetFreeUtilization();
+}
+
+static U32 svc_mem_alloc(U32 *args)
+{
+	return (U32)k_mem_alloc((size_t)args[0]);
+}
+
+// k_mem_dealloc checks the pointer is inside the heap before it reads the block header.
+static U32 svc_mem_dealloc(U32 *args)
+{
+	return (U32)k_mem_dealloc((void*)args[0]);
+}
+
+static U32 svc_mem_count_extfrag(U32 *args)
+{
+	return (U32)k_mem_count_extfrag((size_t)args[0]);
+}
+
+// A blocked caller gets RTX_OK in R0 now and resumes once the mutex is handed to it.
+static U32 svc_mutex_lock(U32 *args)
+{
+	if (!caller_memory((MUTEX*)args[0], sizeof(MUTEX)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osMutexLock((MUTEX*)args[0]);
+}
+
+static U32 svc_mutex_unlock(U32 *args)
+{
+	if (!caller_memory((MUTEX*)args[0], sizeof(MUTEX)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osMutexUnlock((MUTEX*)args[0]);
+}
+
+static U32 svc_sem_take(U32 *args)
+{
+	if (!caller_memory((SEMAPHORE*)args[0], sizeof(SEMAPHORE)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osSemTake((SEMAPHORE*)args[0]);
+}
+
+static U32 svc_sem_give(U32 *args)
+{
+	if (!caller_memory((SEMAPHORE*)args[0], sizeof(SEMAPHORE)))
+	{
+		return (U32)RTX_ERR;
+	}
+	return (U32)osSemGive((SEMAPHORE*)args[0]);
+}
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+// Indexed by SVC immediate. Numbers without an entry fail with RTX_ERR.
+static const svc_fn svc_table[SVC_COUNT] = {
+	[SVC_PRIVILEGED]            = svc_privileged,
+	[SVC_KERNEL_START]          = svc_kernel_start,
+	[SVC_CREATE_TASK]           = svc_create_task,
+	[SVC_CREATE_DEADLINE_TASK]  = svc_create_deadline_task,
+	[SVC_CREATE_PERIODIC_TASK]  = svc_create_periodic_task,
+#if SCHED_POLICY == SCHED_EDF
+	[SVC_CREATE_SERVER_TASK]    = svc_create_server_task,
+#endif
+	[SVC_YIELD]                 = svc_yield,
+	[SVC_YIELD_TO]              = svc_yield_to,
+	[SVC_PERIOD_YIELD]          = svc_period_yield,
+	[SVC_SLEEP]                 = svc_sleep,
+	[SVC_TASK_EXIT]             = svc_task_exit,
+	[SVC_TASK_INFO]             = svc_task_info,
+	[SVC_GET_TID]               = svc_get_tid,
+	[SVC_SET_DEADLINE]          = svc_set_deadline,
+	[SVC_SET_MISS_POLICY]       = svc_set_miss_policy,
+	[SVC_FREE_UTILIZATION]      = svc_free_utilization,
+	[SVC_MEM_ALLOC]             = svc_mem_alloc,
+	[SVC_MEM_DEALLOC]           = svc_mem_dealloc,
+	[SVC_MEM_COUNT_EXTFRAG]     = svc_mem_count_extfrag,
+	[SVC_MUTEX_LOCK]            = svc_mutex_lock,
+	[SVC_MUTEX_UNLOCK]          = svc_mutex_unlock,
+	[SVC_SEM_TAKE]              = svc_sem_take,
+	[SVC_SEM_GIVE]              = svc_sem_give,
+};
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void SVC_Handler_Main(unsigned int *svc_args)
+{
+	// Stack frame contains: R0, R1, R2, R3, R12, LR, PC, xPSR
+	// The SVC immediate is the low byte of the instruction before the stacked PC.
+	U32 svc_number = ((const uint8_t *)svc_args[6])[-2];
+
+	if (svc_number >= SVC_COUNT || svc_table[svc_number] == NULL)
+	{
+		svc_args[0] = (U32)RTX_ERR;
+		return;
+	}
+
+	// The result is popped into the caller's R0 on exception return.
+	svc_args[0] = svc_table[svc_number]((U32 *)svc_args);
+}
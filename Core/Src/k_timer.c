@@ -0,0 +1,321 @@
+#include "k_timer.h"
+#include "k_sched.h"
+#include "k_sync.h"
+#include "k_task.h"
+#include "common.h"
+#include "k_trace.h"
+#include <limits.h>
+#include <stddef.h>
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+// Queues sorted by absolute expiry tick, so a tick only ever looks at the heads.
+static TCB *sleep_queue;    // SLEEPING tasks, ordered by wakeup
+static TCB *release_queue;  // READY/RUNNING/BLOCKED tasks, ordered by absolute deadline
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// Insert a task into a queue so that it fires at the given absolute tick.
+static void queue_insert(TCB **queue, TCB *tcb, U64 expiry)
+{
+	TCB *prev = NULL;
+	TCB *curr = *queue;
+
+	// Entries with the same expiry keep their insertion order.
+	while (curr != NULL && curr->timer_expiry <= expiry)
+	{
+		prev = curr;
+		curr = curr->timer_next;
+	}
+
+	tcb->timer_expiry = expiry;
+	tcb->timer_prev = prev;
+	tcb->timer_next = curr;
+	tcb->timer_list = queue;
+
+	if (curr != NULL)
+	{
+		curr->timer_prev = tcb;
+	}
+	if (prev != NULL)
+	{
+		prev->timer_next = tcb;
+	}
+	else
+	{
+		*queue = tcb;
+	}
+}
+
+// Unlink a task from the queue it is on.
+static void queue_remove(TCB *tcb)
+{
+	TCB **queue = tcb->timer_list;
+	if (queue == NULL)
+	{
+		return;
+	}
+
+	if (tcb->timer_next != NULL)
+	{
+		tcb->timer_next->timer_prev = tcb->timer_prev;
+	}
+	if (tcb->timer_prev != NULL)
+	{
+		tcb->timer_prev->timer_next = tcb->timer_next;
+	}
+	else
+	{
+		*queue = tcb->timer_next;
+	}
+
+	tcb->timer_next = NULL;
+	tcb->timer_prev = NULL;
+	tcb->timer_list = NULL;
+}
+
+// Remove and return the head of a queue if it is due at the current tick.
+static TCB *queue_pop_expired(TCB **queue)
+{
+	TCB *head = *queue;
+	if (head == NULL || head->timer_expiry > kernel_config.tick_count)
+	{
+		return NULL;
+	}
+
+	queue_remove(head);
+	return head;
+}
+
+#if SCHED_POLICY == SCHED_EDF
+/*
+ * CBS wakeup rule: a server keeps its current deadline only if its leftover budget can be served
+ * before that deadline at the reserved bandwidth. Otherwise it starts a fresh server period.
+ */
+static void cbs_wake(TCB *tcb)
+{
+	U64 now = tcb->release;
+
+	if (tcb->abs_deadline <= now ||
+	    (U64)tcb->cbs_remaining * tcb->deadline >= (tcb->abs_deadline - now) * tcb->cbs_budget)
+	{
+		tcb->cbs_remaining = tcb->cbs_budget;
+		tcb->abs_deadline = now + tcb->deadline;
+	}
+}
+
+// Charge the running server for one tick. An exhausted budget is recharged one period later.
+static int cbs_charge(void)
+{
+	if (kernel_config.running_task >= MAX_TASKS)
+	{
+		return FALSE;
+	}
+
+	TCB *tcb = &kernel_config.TCBS[kernel_config.running_task];
+	if (tcb->cbs_budget == 0 || tcb->state != TASK_RUNNING || --tcb->cbs_remaining > 0)
+	{
+		return FALSE;
+	}
+
+	tcb->cbs_remaining = tcb->cbs_budget;
+	tcb->abs_deadline += tcb->deadline;
+	queue_remove(tcb);
+	queue_insert(&release_queue, tcb, tcb->abs_deadline);
+	return TRUE;
+}
+#endif
+
+/*
+ * A hard task is still READY or RUNNING at its deadline. The late job keeps running with its deadline
+ * moved one period on, and the task's miss policy decides what happens to the jobs after it.
+ */
+static void deadline_missed(TCB *tcb)
+{
+	tcb->miss_count++;
+	K_TRACE(TRACE_MISS, tcb->tid, tcb->miss_count);
+
+	switch (tcb->miss_policy)
+	{
+	case MISS_POLICY_CALLBACK:
+		if (tcb->miss_handler != NULL)
+		{
+			tcb->miss_handler(tcb->tid);
+		}
+		break;
+
+	case MISS_POLICY_SKIP:
+		// The late job stands in for the next one, whose release is dropped.
+		tcb->release += tcb->period;
+		break;
+
+	case MISS_POLICY_DEMOTE:
+		// From now on the task only runs when no task that is not demoted is READY, so it gives up
+		// its reservation. The scheduler and admission control both keep to the flag, so a later
+		// osSetDeadline does not undo it. The caller re-queues the task.
+		kernel_config.utilization -= k_sched_utilization(tcb);
+		tcb->demoted = TRUE;
+		k_sched_assign(tcb);
+		tcb->miss_policy = MISS_POLICY_NONE;
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Make a task taken off the sleep queue READY, with a new job released at the given tick.
+static void release_task(TCB *tcb, U64 release)
+{
+	tcb->state = TASK_READY;
+	tcb->release = release;
+#if SCHED_POLICY == SCHED_EDF
+	if (tcb->cbs_budget != 0)
+	{
+		cbs_wake(tcb);
+	}
+	else
+#endif
+	{
+		tcb->abs_deadline = tcb->release + tcb->deadline;
+	}
+	queue_insert(&release_queue, tcb, tcb->abs_deadline);
+	k_sched_insert(tcb);
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void k_timer_init(void)
+{
+	sleep_queue = NULL;
+	release_queue = NULL;
+}
+
+U64 k_timer_now(void)
+{
+	volatile U64 *clock = &kernel_config.tick_count;
+	U64 now;
+
+	// The 64-bit count is two words, re-read if a tick landed in between.
+	do
+	{
+		now = *clock;
+	} while (now != *clock);
+
+	return now;
+}
+
+int k_timer_tick(void)
+{
+	int changed = FALSE;
+	TCB *tcb;
+
+	kernel_config.tick_count++;
+
+	// A task still READY or RUNNING at its deadline has missed it. A server still busy at its
+	// deadline has no hard deadline to miss, it just gets a new period and a full budget. A job
+	// is counted once, when its own deadline passes, not again for each period it stays late.
+	while ((tcb = queue_pop_expired(&release_queue)) != NULL)
+	{
+		if (tcb->cbs_budget == 0 && tcb->abs_deadline == tcb->release + tcb->deadline)
+		{
+			deadline_missed(tcb);
+		}
+		tcb->abs_deadline += tcb->period;
+		tcb->cbs_remaining = tcb->cbs_budget;
+		queue_insert(&release_queue, tcb, tcb->abs_deadline);
+		k_sched_update(tcb);
+		// A BLOCKED job's new deadline also moves it back among the waiters.
+		k_sync_requeue(tcb);
+		changed = TRUE;
+	}
+
+	// Release sleeping tasks at the tick they asked for, not at the tick the ISR got to them.
+	while ((tcb = queue_pop_expired(&sleep_queue)) != NULL)
+	{
+		release_task(tcb, tcb->timer_expiry);
+		K_TRACE(TRACE_WAKE, tcb->tid, 0);
+		changed = TRUE;
+	}
+
+#if SCHED_POLICY == SCHED_EDF
+	if (cbs_charge())
+	{
+		changed = TRUE;
+	}
+#endif
+
+	return changed;
+}
+
+void k_timer_advance(U32 ticks)
+{
+	kernel_config.tick_count += ticks;
+}
+
+U32 k_timer_next_wakeup(void)
+{
+	// A deadline expiring renews the job and may count a miss, so it ends an idle stretch as well.
+	TCB *next = sleep_queue;
+	if (next == NULL || (release_queue != NULL && release_queue->timer_expiry < next->timer_expiry))
+	{
+		next = release_queue;
+	}
+	if (next == NULL)
+	{
+		return UINT_MAX;
+	}
+
+	U64 now = kernel_config.tick_count;
+	if (next->timer_expiry <= now)
+	{
+		return 0;
+	}
+	if (next->timer_expiry - now > UINT_MAX)
+	{
+		return UINT_MAX;
+	}
+	return (U32)(next->timer_expiry - now);
+}
+
+void k_timer_sleep_until(TCB *tcb, U64 wake_time)
+{
+	queue_remove(tcb);
+	queue_insert(&sleep_queue, tcb, wake_time);
+	K_TRACE(TRACE_SLEEP, tcb->tid, wake_time);
+}
+
+void k_timer_wake(TCB *tcb)
+{
+	queue_remove(tcb);
+	release_task(tcb, kernel_config.tick_count);
+	K_TRACE(TRACE_WAKE, tcb->tid, 1);
+}
+
+void k_timer_set_deadline(TCB *tcb)
+{
+	queue_remove(tcb);
+	queue_insert(&release_queue, tcb, tcb->abs_deadline);
+}
+
+void k_timer_cancel(TCB *tcb)
+{
+	queue_remove(tcb);
+}
+
+U32 k_timer_remaining(const TCB *tcb)
+{
+	U64 now = k_timer_now();
+
+	if (tcb->timer_list == NULL || tcb->timer_expiry <= now)
+	{
+		return 0;
+	}
+	return (U32)(tcb->timer_expiry - now);
+}
@@ -0,0 +1,17 @@
+#include "k_trace.h"
+
+#if RTX_TRACE
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+// Dump this symbol from RAM and feed it to tools/trace_decode.py.
+TRACE_BUFFER trace_buffer = {
+	.magic = TRACE_MAGIC,
+	.record_size = sizeof(TRACE_RECORD),
+	.capacity = TRACE_RECORDS,
+	.head = 0,
+};
+
+#endif /* RTX_TRACE */
@@ -1,9 +1,16 @@
 #include "k_task.h"
 #include "k_mem.h"
+#include "k_stack.h"
+#include "k_sync.h"
+#include "k_sched.h"
+#include "k_timer.h"
+#include "k_crit.h"
+#include "k_stats.h"
+#include "k_trace.h"
+#include "port.h"
 #include "common.h"
 #include <stdio.h>
 #include <limits.h>
-#include "stm32f4xx.h"
 
 /************************************************
  *             DEFINITIONS
@@ -23,14 +30,90 @@ KERNEL_CONFIG kernel_config;
  *             HELPER FUNCTIONS
  ************************************************/
 
+// Mark a TID as taken by a new task.
+static inline void tid_alloc(task_t tid)
+{
+	kernel_config.free_tids[tid >> 5] &= ~TID_MAP_BIT(tid);
+	kernel_config.active_tids[tid >> 5] |= TID_MAP_BIT(tid);
+}
+
+// Hold the TID of an exited task until its stack is reclaimed.
+static inline void tid_retire(task_t tid)
+{
+	kernel_config.active_tids[tid >> 5] &= ~TID_MAP_BIT(tid);
+	kernel_config.zombie_tids[tid >> 5] |= TID_MAP_BIT(tid);
+}
+
+// Return a reaped TID to the free map.
+static inline void tid_release(task_t tid)
+{
+	kernel_config.zombie_tids[tid >> 5] &= ~TID_MAP_BIT(tid);
+	kernel_config.free_tids[tid >> 5] |= TID_MAP_BIT(tid);
+}
+
+/*
+ * Reclaim the stacks and TIDs of exited tasks in one pass. The running task may have exited and not
+ * yet switched away, it is still on its stack and waits for the next pass.
+ */
+static void reap_zombies(void)
+{
+	U32 crit = k_crit_enter();
+	for (task_t tid = k_tid_map_next(kernel_config.zombie_tids, 1); tid < MAX_TASKS; tid = k_tid_map_next(kernel_config.zombie_tids, tid + 1))
+	{
+		if (tid == kernel_config.running_task)
+		{
+			continue;
+		}
+		TCB* tcb = &kernel_config.TCBS[tid];
+		k_stack_free(tcb->p_stack_mem);
+		tcb->p_stack_mem = NULL;
+		tcb->state = DORMANT;
+		tid_release(tid);
+	}
+	k_crit_exit(crit);
+}
+
 // A task scheduled when no other tasks are available.
 void null_task(void *) {
     while (1) {
-        // Put the CPU in a low-power state or perform background tasks
-        __WFI(); // Wait For Interrupt, put CPU in sleep mode
+        // Tear down exited tasks while there is nothing else to do
+        reap_zombies();
+        // Sleep until an interrupt, the port suppresses the tick where it can
+        port_idle();
     }
 }
 
+// Record the response time and lateness of the job the task just finished. Call in a critical section.
+static void job_complete(TCB* tcb)
+{
+	U64 now = kernel_config.tick_count;
+	U64 due = tcb->release + tcb->deadline;
+
+	if (now - tcb->release > tcb->worst_response)
+	{
+		tcb->worst_response = (U32)(now - tcb->release);
+	}
+	if (now > due && now - due > tcb->worst_lateness)
+	{
+		tcb->worst_lateness = (U32)(now - due);
+	}
+}
+
+#if STACK_PAINT
+// Bytes from the top of the task's stack down to the lowest word that no longer holds the paint.
+// The guard region is never written, and the running task's own guard cannot even be read.
+static U16 stack_peak(const TCB* tcb)
+{
+	const U32* word = tcb->stack_guard != 0 ? (const U32*)(tcb->stack_guard + PORT_STACK_GUARD_SIZE) : tcb->p_stack_mem;
+	const U32* top = (const U32*)tcb->stack_high;
+	while (word < top && *word == STACK_PAINT_WORD)
+	{
+		word++;
+	}
+	return (U16)(tcb->stack_high - (UPTR)word);
+}
+#endif
+
 // Create the null task
 void osNull_task(void){
 	TCB* create_tcb = &kernel_config.TCBS[0];
@@ -40,112 +123,60 @@ void osNull_task(void){
 	create_tcb->ptask = &null_task;
 	create_tcb->stack_size = STACK_SIZE;
 
-	U32* MSP_INIT_VAL = *(U32**)0x0;
-	create_tcb->p_stack_mem = (U32)(MSP_INIT_VAL - MAIN_STACK_SIZE);
+	create_tcb->p_stack_mem = port_null_stack();
+	create_tcb->stack_guard = 0; // shares the main stack's memory, which has no guard
 	// Initialize the stack for the task
-	create_tcb->SP = (U32)(create_tcb->p_stack_mem);
-	U32* stackptr = (U32*)create_tcb->SP;
-
-	// Set up initial stack frame
-	*(--stackptr) = 1 << 24;                    // xPSR, setting Thumb mode
-	*(--stackptr) = create_tcb->ptask;          // PC, function address
-	for (int i = 0; i < 14; i++) {
-		*(--stackptr) = 0xA;
-	}
-
-	create_tcb->SP = stackptr;
+	create_tcb->SP = port_stack_init(create_tcb, create_tcb->p_stack_mem);
 }
 
+// Returns the ready task with the earliest deadline, or the null task if none is ready.
 static task_t scheduler(void)
 {
-	task_t next_task = TID_DORMANT;
-	int earliest_deadline = INT_MAX;
-	int all_sleeping = TRUE;
-	int all_dormant = TRUE;
-
-
-	//Find earliest deadline among ready tasks
-    for (int i = 1; i < MAX_TASKS; i++)
-    {
-        if (kernel_config.TCBS[i].state != DORMANT)
-        {
-			// Found a non-dormant task.
-            all_dormant = FALSE;
-
-            if (kernel_config.TCBS[i].state == READY)
-            {
-                all_sleeping = FALSE;
-				// Update earliest deadline.
-                if (kernel_config.TCBS[i].remaining_time < earliest_deadline)
-                {
-                    earliest_deadline = kernel_config.TCBS[i].remaining_time;
-                    next_task = i;
-                }
-            } else if (kernel_config.TCBS[i].state == RUNNING)
-            {
-				// Found a running task.
-                all_sleeping = FALSE;
-            }
-        }
-    }
-
-    //If all tasks are dormant/ sleeping
-    if (all_dormant || all_sleeping)
-    {
-    	return 0;
-    }
-
-    return next_task;
-}
-
-void SVC_Handler_Main(unsigned int *svc_args) {
-
-	unsigned int svc_number;
-
-    // Stack frame contains: R0, R1, R2, R3, R12, LR, PC, xPSR
-    // SVC number is the immediate value passed in the SVC instruction
-    // It can be found at the address of the PC (Program Counter) - 2
-    svc_number = ((char *)svc_args[6])[-2];
-
-    // Handle the system call based on the svc_number
-    // For demonstration, we'll just print the SVC number
-    printf("System Call Number: %u\n", svc_number);
-
-    switch (svc_number){
-		case 0:
-			__set_CONTROL(__get_CONTROL()& ~CONTROL_nPRIV_Msk);
-			break;
-		case 1:
-			os_kernel_start();
-			break;
-    }
-    return;
-
+	return k_sched_pop();
 }
 
 /*
  * This function is called from the PendSV handler in the context switch process 
  * to get the new task to run and set some of its state.
 */
-void new_task()
+void new_task(void)
 {
 	task_t new_task;
+	U32 crit = k_crit_enter();
 
-	kernel_config.TCBS[kernel_config.running_task].SP = __get_PSP();
+	kernel_config.TCBS[kernel_config.running_task].SP = port_get_psp();
 	if (kernel_config.TCBS[kernel_config.running_task].state == RUNNING){
 		kernel_config.TCBS[kernel_config.running_task].state = READY;
+		k_sched_insert(&kernel_config.TCBS[kernel_config.running_task]);
 	}
 
-	// Run scheduler to get new task to run and set to running task
-	new_task = scheduler();
-
-	kernel_config.running_task = new_task;
+	// Take an osYieldTo target directly if nothing READY is more urgent, otherwise run the scheduler.
+	new_task = kernel_config.yield_to;
+	kernel_config.yield_to = TID_NULL;
+	if (new_task != TID_NULL && kernel_config.TCBS[new_task].state == READY &&
+	    !k_sched_more_urgent(&kernel_config.TCBS[k_sched_peek()], &kernel_config.TCBS[new_task]))
+	{
+		k_sched_remove(&kernel_config.TCBS[new_task]);
+	}
+	else
+	{
+		new_task = scheduler();
+	}
 
 	// set state of new task to running
 	kernel_config.TCBS[new_task].state = RUNNING;
 
-	// Update PSP to SP of new task
-	__set_PSP((U32)kernel_config.TCBS[new_task].SP);
+	k_stats_switch(&kernel_config.TCBS[kernel_config.running_task], &kernel_config.TCBS[new_task]);
+	if (new_task != kernel_config.running_task)
+	{
+		K_TRACE(TRACE_SWITCH, new_task, kernel_config.running_task);
+	}
+	kernel_config.running_task = new_task;
+
+	// Update PSP to SP of new task and move the stack guard below it
+	port_set_psp(kernel_config.TCBS[new_task].SP);
+	port_set_stack_guard(kernel_config.TCBS[new_task].stack_guard);
+	k_crit_exit(crit);
 
 	return;
 }
@@ -157,6 +188,8 @@ static const char* get_task_state_string(U8 state) {
         case TASK_READY: return "READY";
         case TASK_RUNNING: return "RUNNING";
         case TASK_SLEEPING: return "SLEEPING";
+        case TASK_ZOMBIE: return "ZOMBIE";
+        case TASK_BLOCKED: return "BLOCKED";
         default: return "UNKNOWN";
     }
 }
@@ -168,7 +201,7 @@ void print_kernel_info(void) {
     printf("Currently running task ID: %u\r\n\n", kernel_config.running_task);
 
     printf("=== Task Control Blocks ===\n");
-    for (int i = 0; i < MAX_TASKS; i++) {
+    for (task_t i = k_tid_map_next(kernel_config.active_tids, 0); i < MAX_TASKS; i = k_tid_map_next(kernel_config.active_tids, i + 1)) {
         TCB* tcb = &kernel_config.TCBS[i];
 
         printf("Task %d:\r\n", i);
@@ -189,6 +222,30 @@ void print_kernel_info(void) {
  *             FUNCTIONS
  ************************************************/
 
+task_t k_tid_map_next(const U32* map, task_t from)
+{
+	if (from >= MAX_TASKS)
+	{
+		return MAX_TASKS;
+	}
+
+	// Ignore the TIDs below from in the first word, then take the first non-empty word.
+	U32 word = from >> 5;
+	U32 bits = map[word] & (0xFFFFFFFFU >> (from & 31));
+
+	while (bits == 0)
+	{
+		if (++word >= TID_MAP_WORDS)
+		{
+			return MAX_TASKS;
+		}
+		bits = map[word];
+	}
+
+	task_t tid = (word << 5) + __builtin_clz(bits);
+	return tid < MAX_TASKS ? tid : MAX_TASKS;
+}
+
 void ContextSwitch(void)
 {
 	if(kernel_config.is_running == FALSE || kernel_config.running_task == TID_DORMANT)
@@ -197,19 +254,35 @@ void ContextSwitch(void)
 	}
 
 	// Call PendSV handler (Lab1.s)
-	SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
-	__asm("isb");
+	port_pend_switch();
 
 	return;
 }
 
+void k_tick(void)
+{
+	if (!kernel_config.is_running)
+	{
+		return;
+	}
+
+	// Only the heads of the sleep and release queues are touched. Reschedule when one fired.
+	// Kernel-aware interrupts above the tick's priority are held off while the queues change.
+	U32 crit = k_crit_enter();
+	if (k_timer_tick())
+	{
+		ContextSwitch();
+	}
+	k_stats_tick();
+	k_crit_exit(crit);
+}
+
 void osKernelInit(void)
 {
-	SHPR3 |= 0xFFU << 24; //Set the priority of SysTick to be the weakest
-	SHPR3 |= 0xFEU << 16; //shift the constant 0xFE 16 bits to set PendSV priority
-	SHPR2 |= 0xFDU << 24; //set the priority of SVC higher than PendSV
+	port_init();
+	k_stack_init();
     // Initialize TCBs
-    for (U8 i = 0; i < MAX_TASKS; i++)
+    for (int i = 0; i < MAX_TASKS; i++)
     {
         kernel_config.TCBS[i].tid = TID_DORMANT;
         kernel_config.TCBS[i].state = TASK_DORMANT;
@@ -218,13 +291,62 @@ void osKernelInit(void)
         kernel_config.TCBS[i].stack_size = 0x4000;
         kernel_config.TCBS[i].remaining_sleep_time = DEFAULT_SLEEP_TIME;
         kernel_config.TCBS[i].deadline = DEFAULT_DEADLINE;
+        kernel_config.TCBS[i].period = DEFAULT_DEADLINE;
+        kernel_config.TCBS[i].wcet = 0;
         kernel_config.TCBS[i].remaining_time = DEFAULT_DEADLINE;
+        kernel_config.TCBS[i].release = 0;
+        kernel_config.TCBS[i].abs_deadline = 0;
+        kernel_config.TCBS[i].timer_next = NULL;
+        kernel_config.TCBS[i].timer_prev = NULL;
+        kernel_config.TCBS[i].timer_list = NULL;
+        kernel_config.TCBS[i].cbs_budget = 0;
+        kernel_config.TCBS[i].cbs_remaining = 0;
+        kernel_config.TCBS[i].miss_count = 0;
+        kernel_config.TCBS[i].worst_response = 0;
+        kernel_config.TCBS[i].worst_lateness = 0;
+        kernel_config.TCBS[i].miss_policy = MISS_POLICY_NONE;
+        kernel_config.TCBS[i].demoted = FALSE;
+        kernel_config.TCBS[i].miss_handler = NULL;
+        kernel_config.TCBS[i].run_cycles = 0;
+        kernel_config.TCBS[i].load_base = 0;
+        kernel_config.TCBS[i].cpu_load = 0;
+        kernel_config.TCBS[i].switch_count = 0;
+        kernel_config.TCBS[i].preempt_count = 0;
+        kernel_config.TCBS[i].inherit_deadline = 0;
+        kernel_config.TCBS[i].inherit_priority = PRIORITY_LEVELS;
+        kernel_config.TCBS[i].held = NULL;
+        kernel_config.TCBS[i].blocked_on = NULL;
+        kernel_config.TCBS[i].wait_queue = NULL;
+        kernel_config.TCBS[i].wait_next = NULL;
     }
 
+    // Every TID except the null task's starts out free.
+    for (int i = 0; i < TID_MAP_WORDS; i++)
+    {
+        kernel_config.free_tids[i] = 0;
+        kernel_config.active_tids[i] = 0;
+        kernel_config.zombie_tids[i] = 0;
+    }
+    for (int i = 1; i < MAX_TASKS; i++)
+    {
+        kernel_config.free_tids[i >> 5] |= TID_MAP_BIT(i);
+    }
+    kernel_config.active_tids[0] = TID_MAP_BIT(TID_NULL);
+
+    k_sched_init();
+    k_timer_init();
+
     // Init other members
     kernel_config.num_running_tasks = 0;
     kernel_config.is_running = TRUE;
     kernel_config.running_task = TID_DORMANT;
+    kernel_config.tick_count = 0;
+    kernel_config.utilization = 0;
+    kernel_config.yield_to = TID_NULL;
+    kernel_config.yielding = FALSE;
+    kernel_config.switch_stamp = 0;
+    kernel_config.load_stamp = 0;
+    kernel_config.load_window_end = CPU_LOAD_WINDOW;
     osNull_task();
 }
 
@@ -248,11 +370,12 @@ int osKernelStart(void){
 		// Get the first task and run it 
 		task_t firstTask = scheduler();
 		kernel_config.running_task = firstTask;
-		__set_PSP((U32)kernel_config.TCBS[kernel_config.running_task].SP);
+		port_set_psp(kernel_config.TCBS[kernel_config.running_task].SP);
 		kernel_config.TCBS[kernel_config.running_task].state = RUNNING;
-		HAL_Init();
-		// Calls os_kernel_start (lab1.s) which restores context of scheduled task.
-		__asm("SVC #1");
+		kernel_config.TCBS[kernel_config.running_task].switch_count++;
+		k_stats_init();
+		// Restores the context of the scheduled task.
+		port_start();
 	}
 	return RTX_OK;
 }
@@ -263,16 +386,43 @@ void osYield(void){
 		return;
 	}
 
-	// Reset a task’s time remaining back to its deadline.
-	kernel_config.TCBS[kernel_config.running_task].remaining_time = kernel_config.TCBS[kernel_config.running_task].deadline;
+	// Reset a task’s time remaining back to its deadline. A server keeps its deadline, it only
+	// moves when the budget runs out.
+	TCB* tcb = &kernel_config.TCBS[kernel_config.running_task];
+	kernel_config.yielding = TRUE;
+	if (tcb->cbs_budget == 0)
+	{
+		U32 crit = k_crit_enter();
+		job_complete(tcb);
+		tcb->release = kernel_config.tick_count;
+		tcb->abs_deadline = tcb->release + tcb->deadline;
+		k_timer_set_deadline(tcb);
+		k_crit_exit(crit);
+	}
 
 	// Call PendSV to save state and restore state of new task.
-	SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
-	__asm("isb");
+	port_pend_switch();
 
 	return;
 }
 
+int osYieldTo(task_t TID){
+	if(kernel_config.is_running == FALSE || kernel_config.running_task == TID_DORMANT)
+	{
+		return RTX_ERR;
+	}
+	if (TID == TID_NULL || TID >= MAX_TASKS || !(kernel_config.active_tids[TID >> 5] & TID_MAP_BIT(TID)))
+	{
+		return RTX_ERR;
+	}
+
+	// new_task checks the target is still eligible when PendSV runs.
+	kernel_config.yield_to = TID;
+	osYield();
+
+	return RTX_OK;
+}
+
 int osTaskExit(void)
 {
 	if(kernel_config.is_running == FALSE || kernel_config.running_task == TID_DORMANT){
@@ -283,129 +433,256 @@ int osTaskExit(void)
 	if(current_tid == TID_DORMANT){
 		return RTX_ERR;
 	}
-	// Deallocate task's stack.
-	if(k_mem_dealloc(kernel_config.TCBS[current_tid].p_stack_mem )== -1)
-	{
-		return RTX_ERR;
-	}
-
-	//set current task to dormant
-	kernel_config.TCBS[current_tid].state = DORMANT;
+	U32 crit = k_crit_enter();
+	// Only retire the task here. It is still on its stack, which reap_zombies frees once it is off it.
+	k_timer_cancel(&kernel_config.TCBS[current_tid]);
+	kernel_config.utilization -= k_sched_utilization(&kernel_config.TCBS[current_tid]);
+	kernel_config.TCBS[current_tid].state = ZOMBIE;
 	kernel_config.TCBS[current_tid].tid = TID_DORMANT;
+	k_sync_release_all(&kernel_config.TCBS[current_tid]);
+	tid_retire(current_tid);
 	kernel_config.num_running_tasks--;
+	K_TRACE(TRACE_EXIT, current_tid, 0);
+	k_crit_exit(crit);
 
 	ContextSwitch();
 
 	return RTX_OK;
 }
 
-// Default task is a deadline task with 5 ms deadline.
-int osCreateTask(TCB* task){
-	return osCreateDeadlineTask(5, task);
-}
-
 int osTaskInfo(task_t TID, TCB *task_copy) {
 	if(kernel_config.num_running_tasks <= 1){
 		return RTX_ERR;
 	}
+	// TIDs index the TCB table directly, check the task exists
+	if (TID == TID_NULL || TID >= MAX_TASKS || !(kernel_config.active_tids[TID >> 5] & TID_MAP_BIT(TID))) {
+		return RTX_ERR;
+	}
+
 	// Copy TCB into task copy
-	for (int i = 1; i < MAX_TASKS; i++) {
-		if (kernel_config.TCBS[i].tid == TID) {
-			memacopy(task_copy, kernel_config.TCBS + i, sizeof(TCB));
-			return RTX_OK;
-		}
+	memacopy(task_copy, kernel_config.TCBS + TID, sizeof(TCB));
+
+	// Timer state is kept as absolute expiry ticks, convert it back to tick counts.
+	if (task_copy->state == SLEEPING)
+	{
+		task_copy->remaining_sleep_time = k_timer_remaining(kernel_config.TCBS + TID);
 	}
+	else
+	{
+		task_copy->remaining_time = k_timer_remaining(kernel_config.TCBS + TID);
+	}
+#if STACK_PAINT
+	task_copy->stack_peak = stack_peak(kernel_config.TCBS + TID);
+#else
+	task_copy->stack_peak = 0;
+#endif
+	return RTX_OK;
+}
 
+int osGetStackPeak(task_t TID)
+{
+#if STACK_PAINT
+	if (TID == TID_NULL || TID >= MAX_TASKS || !(kernel_config.active_tids[TID >> 5] & TID_MAP_BIT(TID)))
+	{
+		return RTX_ERR;
+	}
+	return stack_peak(&kernel_config.TCBS[TID]);
+#else
 	return RTX_ERR;
+#endif
 }
 
 int osSetDeadline(int deadline, task_t TID){
-	// Since changing a deadline must be done atomically interrupts are disabled
-    __disable_irq();
+	// Since changing a deadline must be done atomically the kernel's interrupts are masked
+	U32 crit = k_crit_enter();
 	// error
 	if( deadline <= 0 || TID <= 0 || TID >= MAX_TASKS || kernel_config.TCBS[TID].tid == -1 || TID == kernel_config.running_task)
 	{
-        __enable_irq();
+		k_crit_exit(crit);
+		return RTX_ERR;
+	}
+
+	// A task with an implicit deadline keeps its period equal to the deadline. Its share of the CPU
+	// changes with it, which must still fit.
+	TCB* tcb = &kernel_config.TCBS[TID];
+	U32 period = tcb->period == tcb->deadline ? (U32)deadline : tcb->period;
+	if ((U32)deadline > period)
+	{
+		k_crit_exit(crit);
+		return RTX_ERR;
+	}
+	TCB updated = *tcb;
+	updated.period = period;
+	updated.deadline = deadline;
+	U32 utilization = kernel_config.utilization - k_sched_utilization(tcb) + k_sched_utilization(&updated);
+	if (utilization > UTIL_FULL)
+	{
+		k_crit_exit(crit);
 		return RTX_ERR;
 	}
 
 	// Update deadline and related fields
-	kernel_config.TCBS[TID].deadline = deadline;
-	kernel_config.TCBS[TID].remaining_time = deadline;
-	U32 current_task_remaing_time =  kernel_config.TCBS[kernel_config.running_task].remaining_time;
-	// Context switch if new deadline is less than the running task.
-	if (kernel_config.TCBS[TID].remaining_time < current_task_remaing_time)
+	kernel_config.utilization = utilization;
+	tcb->period = period;
+	tcb->deadline = deadline;
+	tcb->release = k_timer_now();
+	tcb->abs_deadline = tcb->release + deadline;
+	k_sched_assign(tcb);
+	// A BLOCKED job's deadline keeps running as well, and its place among the waiters moves with it.
+	if (tcb->state == READY || tcb->state == BLOCKED)
+	{
+		k_timer_set_deadline(tcb);
+		k_sched_update(tcb);
+		k_sync_requeue(tcb);
+	}
+	// Context switch if the task, or an owner it passes its deadline to, now comes before the running
+	// task. PendSV runs once the section ends.
+	task_t next = k_sched_peek();
+	if (next != TID_NULL && k_sched_preempts(&kernel_config.TCBS[next], &kernel_config.TCBS[kernel_config.running_task]))
 	{
-        __enable_irq();
 		ContextSwitch();
-	}else{
-        __enable_irq();
 	}
+	k_crit_exit(crit);
 
 	return RTX_OK;
 }
 
-int osCreateDeadlineTask(int deadline, TCB* task){
-	if(kernel_config.num_running_tasks >= MAX_TASKS || deadline <= 0 || task == NULL || task->ptask == NULL || task->stack_size < STACK_SIZE){
+int osSetMissPolicy(task_t TID, int policy, void (*handler)(task_t tid)){
+	if (TID == TID_NULL || TID >= MAX_TASKS || !(kernel_config.active_tids[TID >> 5] & TID_MAP_BIT(TID)) ||
+	    policy < MISS_POLICY_NONE || policy > MISS_POLICY_DEMOTE || (policy == MISS_POLICY_CALLBACK && handler == NULL))
+	{
 		return RTX_ERR;
 	}
 
-	// Find available TID
-	int create_tid = -1;
-	for(int i =1; i < MAX_TASKS; i++){
-		if(kernel_config.TCBS[i].tid == TID_DORMANT){
-			create_tid = i;
-			break;
-		}
+	// The SysTick handler reads both fields when a deadline passes, update them together.
+	U32 crit = k_crit_enter();
+	kernel_config.TCBS[TID].miss_handler = handler;
+	kernel_config.TCBS[TID].miss_policy = (U8)policy;
+	k_crit_exit(crit);
+
+	return RTX_OK;
+}
+
+/*
+ * Shared body of the task creation calls. A budget of 0 creates a hard deadline task, otherwise the
+ * task is a constant bandwidth server that may run for budget ticks every deadline ticks. Tasks with
+ * a wcet must pass admission control before any memory is taken. A server is admitted with its
+ * budget as its wcet if reserve is TRUE or the task declared a wcet, and otherwise is only bounded by
+ * its budget.
+ */
+static int create_task(int period, int deadline, U32 budget, int reserve, TCB* task){
+	if(kernel_config.num_running_tasks >= MAX_TASKS || deadline <= 0 || deadline > period || task == NULL || task->ptask == NULL || task->stack_size < STACK_SIZE){
+		return RTX_ERR;
+	}
+
+	// Find available TID and claim it, a task preempting this one may be creating too.
+	U32 crit = k_crit_enter();
+	task_t create_tid = k_tid_map_next(kernel_config.free_tids, 1);
+	if (create_tid >= MAX_TASKS)
+	{
+		// The null task has not run since some tasks exited, reclaim them now.
+		reap_zombies();
+		create_tid = k_tid_map_next(kernel_config.free_tids, 1);
 	}
-	if(create_tid == -1){
+	if(create_tid >= MAX_TASKS){
+		k_crit_exit(crit);
 		return RTX_ERR;
 	}
+	kernel_config.free_tids[create_tid >> 5] &= ~TID_MAP_BIT(create_tid);
 
 	// Create a new TCB and populate with values in task
 	TCB* create_tcb = &kernel_config.TCBS[create_tid];
 	task->tid = create_tid;
 	*create_tcb= *task;
 	create_tcb->tid = create_tid;
+	create_tcb->period = period;
+	create_tcb->deadline = deadline;
+	create_tcb->wcet = budget > 0 && (reserve || task->wcet != 0) ? budget : task->wcet;
+	create_tcb->demoted = FALSE;
+	k_sched_assign(create_tcb);
 
+	if (k_sched_admit(create_tcb) != RTX_OK)
+	{
+		kernel_config.free_tids[create_tid >> 5] |= TID_MAP_BIT(create_tid);
+		k_crit_exit(crit);
+		task->tid = -1;
+		return RTX_ERR;
+	}
+	// Reserve the share now so a task created from an interrupt cannot claim it too.
+	kernel_config.utilization += k_sched_utilization(create_tcb);
+	k_crit_exit(crit);
+
+	// The stack comes from the pool, its size is rounded up to the class it was taken from.
 	create_tcb->stack_size=task->stack_size;
 	create_tcb->ptask = task->ptask;
-	create_tcb->p_stack_mem = (U32*)(k_mem_alloc(create_tcb->stack_size));
-	// Memory cannot be allocated for the new task
+	create_tcb->p_stack_mem = k_stack_alloc(&create_tcb->stack_size);
+	if (create_tcb->p_stack_mem == NULL)
+	{
+		reap_zombies();
+		create_tcb->p_stack_mem = k_stack_alloc(&create_tcb->stack_size);
+	}
+	// No stack large enough is free for the new task
 	if(create_tcb->p_stack_mem == NULL){
+		crit = k_crit_enter();
+		kernel_config.utilization -= k_sched_utilization(create_tcb);
+		kernel_config.free_tids[create_tid >> 5] |= TID_MAP_BIT(create_tid);
+		k_crit_exit(crit);
 		task->tid = -1;
 		return RTX_ERR;
 	}
 
-	// Transfer ownership of memory to new task.
-	transfer_memory(create_tcb->p_stack_mem, create_tcb->tid);
-	create_tcb->SP = (U32*)((U32)create_tcb->p_stack_mem + (U32)create_tcb->stack_size);
-	create_tcb->stack_high = (U32)create_tcb->SP;
-
-	// Initialize the stack for the task
-	U32* stackptr = (U32*)create_tcb->SP;
-
-	// Set up initial stack frame
-	*(--stackptr) = 1 << 24;                // xPSR, setting Thumb mode
-	*(--stackptr) = task->ptask;      		// PC, function address
-	for (int i = 0; i < 14; i++) {
-		*(--stackptr) = 0xA;
+	create_tcb->SP = (U32*)((UPTR)create_tcb->p_stack_mem + create_tcb->stack_size);
+	create_tcb->stack_high = (UPTR)create_tcb->SP;
+#if STACK_PAINT
+	for (U32* word = create_tcb->p_stack_mem; word < create_tcb->SP; word++)
+	{
+		*word = STACK_PAINT_WORD;
 	}
+#endif
+	create_tcb->stack_guard = port_stack_guard(create_tcb->p_stack_mem);
 
-	create_tcb->SP = stackptr;
+	// Initialize the stack for the task
+	create_tcb->SP = port_stack_init(create_tcb, create_tcb->SP);
 
 	// Copy the initialized TCB back to the provided task structure
+	crit = k_crit_enter();
+	tid_alloc(create_tid);
 	kernel_config.num_running_tasks++;
 	create_tcb->state = TASK_READY;
 	create_tcb->tid = create_tid;
-	create_tcb->deadline = deadline;
 	create_tcb->remaining_time = deadline;
 	create_tcb->remaining_sleep_time = DEFAULT_SLEEP_TIME;
+	create_tcb->release = k_timer_now();
+	create_tcb->abs_deadline = create_tcb->release + deadline;
+	create_tcb->timer_next = NULL;
+	create_tcb->timer_prev = NULL;
+	create_tcb->timer_list = NULL;
+	create_tcb->cbs_budget = budget;
+	create_tcb->cbs_remaining = budget;
+	create_tcb->miss_count = 0;
+	create_tcb->worst_response = 0;
+	create_tcb->worst_lateness = 0;
+	create_tcb->miss_policy = MISS_POLICY_NONE;
+	create_tcb->miss_handler = NULL;
+	create_tcb->run_cycles = 0;
+	create_tcb->load_base = 0;
+	create_tcb->cpu_load = 0;
+	create_tcb->switch_count = 0;
+	create_tcb->preempt_count = 0;
+	create_tcb->inherit_deadline = 0;
+	create_tcb->inherit_priority = PRIORITY_LEVELS;
+	create_tcb->held = NULL;
+	create_tcb->blocked_on = NULL;
+	create_tcb->wait_queue = NULL;
+	create_tcb->wait_next = NULL;
+
+	k_timer_set_deadline(create_tcb);
+	k_sched_insert(create_tcb);
+	K_TRACE(TRACE_CREATE, create_tid, deadline);
+	k_crit_exit(crit);
 
 	// Schedule newly created task if it has shorter time slice.
-	U32 current_task_remaing_time =  kernel_config.TCBS[kernel_config.running_task].remaining_time;
-
-	if ((create_tcb->remaining_time < current_task_remaing_time) && (kernel_config.running_task != TID_DORMANT))
+	if ((kernel_config.running_task != TID_DORMANT) && k_sched_preempts(create_tcb, &kernel_config.TCBS[kernel_config.running_task]))
 	{
 		ContextSwitch();
 	}
@@ -413,27 +690,106 @@ int osCreateDeadlineTask(int deadline, TCB* task){
 	return RTX_OK;
 }
 
+#if SCHED_POLICY == SCHED_EDF
+// Default task is an aperiodic task served by a CBS, so it cannot eat into the deadline tasks' share.
+// Its bandwidth is only reserved if it declared a wcet, so MAX_TASKS default tasks still fit.
+int osCreateTask(TCB* task){
+	return create_task(CBS_DEFAULT_PERIOD, CBS_DEFAULT_PERIOD, CBS_DEFAULT_BUDGET, FALSE, task);
+}
+#else
+// Default task is a deadline task with 5 ms deadline.
+int osCreateTask(TCB* task){
+	return osCreateDeadlineTask(5, task);
+}
+#endif
+
+int osCreateDeadlineTask(int deadline, TCB* task){
+	return create_task(deadline, deadline, 0, FALSE, task);
+}
+
+int osCreatePeriodicTask(int period, int deadline, TCB* task){
+	return create_task(period, deadline, 0, FALSE, task);
+}
+
+U32 osGetFreeUtilization(void){
+	U32 utilization = kernel_config.utilization;
+	return utilization < UTIL_FULL ? UTIL_FULL - utilization : 0;
+}
+
+#if SCHED_POLICY == SCHED_EDF
+int osCreateServerTask(int budget, int period, TCB* task){
+	if (budget <= 0 || budget > period)
+	{
+		return RTX_ERR;
+	}
+	return create_task(period, period, (U32)budget, TRUE, task);
+}
+#endif
+
 void osSleep(int timeInMs)
 {
 	if (timeInMs <= 0){
 		return;
 	}
-	//set state to sleeping
+	//set state to sleeping and queue the wakeup
+	U32 crit = k_crit_enter();
 	kernel_config.TCBS[kernel_config.running_task].state = SLEEPING;
-
-	//set sleep time
-	kernel_config.TCBS[kernel_config.running_task].remaining_sleep_time = (U32) timeInMs;
+	k_timer_sleep_until(&kernel_config.TCBS[kernel_config.running_task], kernel_config.tick_count + (U32) timeInMs);
+	k_crit_exit(crit);
 
 	ContextSwitch();
 
 	return;
 }
 
+int osWakeFromISR(task_t TID)
+{
+	if (TID == TID_NULL || TID >= MAX_TASKS || !(kernel_config.active_tids[TID >> 5] & TID_MAP_BIT(TID)))
+	{
+		return RTX_ERR;
+	}
+
+	// The caller may have preempted SysTick or another kernel-aware interrupt.
+	U32 crit = k_crit_enter();
+	TCB* tcb = &kernel_config.TCBS[TID];
+	if (tcb->state != SLEEPING)
+	{
+		k_crit_exit(crit);
+		return RTX_ERR;
+	}
+	k_timer_wake(tcb);
+
+	// Switch on exception return if the woken task should run now. The null task always yields.
+	if (kernel_config.running_task == TID_NULL || k_sched_preempts(tcb, &kernel_config.TCBS[kernel_config.running_task]))
+	{
+		port_pend_switch();
+	}
+	k_crit_exit(crit);
+	return RTX_OK;
+}
+
 void osPeriodYield(){
-	// because this is a periodic task which cant be scheduled till its period is over we set its state to sleeping
-	kernel_config.TCBS[kernel_config.running_task].state = SLEEPING;
-	// so out remaining sleeptime is actually just the remaining task time for this task
-	kernel_config.TCBS[kernel_config.running_task].remaining_sleep_time = kernel_config.TCBS[kernel_config.running_task].remaining_time;
+	TCB* tcb = &kernel_config.TCBS[kernel_config.running_task];
+
+	U32 crit = k_crit_enter();
+	job_complete(tcb);
+	kernel_config.yielding = TRUE;
+	// The next job is released exactly one period after this one, no matter when this one finished.
+	U64 next_release = tcb->release + tcb->period;
+	if (next_release > kernel_config.tick_count)
+	{
+		// because this is a periodic task which cant be scheduled till its period is over we set its state to sleeping
+		tcb->state = SLEEPING;
+		k_timer_sleep_until(tcb, next_release);
+	}
+	else
+	{
+		// The job overran its period, so the next one is already due.
+		tcb->release = next_release;
+		tcb->abs_deadline = next_release + tcb->deadline;
+		k_timer_set_deadline(tcb);
+	}
+	k_crit_exit(crit);
 
 	ContextSwitch();
 }
@@ -1,28 +1,39 @@
 .syntax unified
 .cpu cortex-m4
+.fpu fpv4-sp-d16
 .thumb
 
+/*
+ * Software-saved part of a task frame, lowest address first:
+ *   R4-R11, EXC_RETURN, [S16-S31 if EXC_RETURN bit 4 is clear]
+ * followed by the frame stacked by hardware on exception entry.
+ */
+
 .global os_kernel_start
 .thumb_func
 os_kernel_start:
 	MRS R0, PSP
-    LDMIA R0!, {R4 - R11}
-    MSR PSP, R0
-    LDR LR, =0xFFFFFFFD
-    BX LR
+	LDMIA R0!, {R4-R11, LR}
+	MSR PSP, R0
+	BX LR
 
 
 .global PendSV_Handler
 .thumb_func
 PendSV_Handler:
 	MRS R0, PSP
-	STMDB R0!, {R4-R11}
+	TST LR, #0x10           @ bit 4 clear: the task has an active FPU context
+	IT EQ
+	VSTMDBEQ R0!, {S16-S31} @ also triggers the deferred lazy stacking of S0-S15
+	STMDB R0!, {R4-R11, LR}
 	MSR PSP, R0
 
 	BL new_task
 
 	MRS R0, PSP
-	LDMIA R0!, {R4-R11}
+	LDMIA R0!, {R4-R11, LR}
+	TST LR, #0x10
+	IT EQ
+	VLDMIAEQ R0!, {S16-S31}
 	MSR PSP, R0
-	LDR LR, =0xFFFFFFFD
 	BX LR
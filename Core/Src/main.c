@@ -3,6 +3,7 @@
 #include "common.h"
 #include "k_task.h"
 #include "k_mem.h"
+#include "bench.h"
 
 
 int i_test = 0;
@@ -38,7 +39,10 @@ int main(void){
 	HAL_Init();
 
 	/* Configure the system clock */
+#if !RTX_BENCHMARK
+	// The benchmark stays on the reset clock (HSI), QEMU does not emulate the PLL.
 	SystemClock_Config();
+#endif
 
 	/* Initialize all configured peripherals */
 	MX_GPIO_Init();
@@ -47,7 +51,11 @@ int main(void){
 	osKernelInit();
 	k_mem_init();
 
-	TCB st_mytask;
+#if RTX_BENCHMARK
+	bench_start();
+#endif
+
+	TCB st_mytask = {0};
 	st_mytask.stack_size = STACK_SIZE;
 	st_mytask.ptask = &TaskA;
 	osCreateDeadlineTask(4, &st_mytask);
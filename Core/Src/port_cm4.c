@@ -0,0 +1,220 @@
+#include "port.h"
+
+#if RTX_PORT == PORT_CM4
+
+#include "k_sched.h"
+#include "k_timer.h"
+#include "common.h"
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal.h"
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#define SHPR2 *(uint32_t*)0xE000ED1C //for setting SVC priority, bits 31-24
+#define SHPR3 *(uint32_t*)0xE000ED20 //PendSV is bits 23-16
+#define EXC_RETURN_THREAD_PSP         0xFFFFFFFD // return to thread mode on PSP without FPU state
+
+// MPU region attributes: access from unprivileged code, and the memory type of the default map.
+#define MPU_AP_FULL      (3U << MPU_RASR_AP_Pos)
+#define MPU_AP_READ      (6U << MPU_RASR_AP_Pos)
+#define MPU_NORMAL_WT    (1U << MPU_RASR_C_Pos)
+#define MPU_NORMAL_WB    ((1U << MPU_RASR_S_Pos) | (1U << MPU_RASR_C_Pos) | (1U << MPU_RASR_B_Pos))
+#define MPU_DEVICE       ((1U << MPU_RASR_S_Pos) | (1U << MPU_RASR_B_Pos) | MPU_RASR_XN_Msk)
+#define MPU_REGION(number, base, size_log2, attributes) \
+	do { \
+		MPU->RBAR = (base) | MPU_RBAR_VALID_Msk | (number); \
+		MPU->RASR = (attributes) | (((size_log2) - 1U) << MPU_RASR_SIZE_Pos) | MPU_RASR_ENABLE_Msk; \
+	} while (0)
+
+// SysTick runs the kernel tick, so BASEPRI must be able to mask it. HAL_InitTick sets it to this.
+#if TICK_INT_PRIORITY < KERNEL_IRQ_PRIORITY
+#error "TICK_INT_PRIORITY must not be more urgent than KERNEL_IRQ_PRIORITY"
+#endif
+
+extern uint32_t _img_end;
+extern uint32_t _estack;
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// Account for ticks that elapsed while SysTick was suppressed. Never crosses a wakeup.
+static void tick_advance(U32 ticks)
+{
+	uwTick += ticks;
+	k_timer_advance(ticks);
+}
+
+/*
+ * Stops the periodic tick and sleeps until the next timer event. SysTick is reloaded so that it
+ * fires on the tick boundary of the earliest wakeup or deadline, and the ticks skipped in between
+ * are added back to the kernel and HAL tick counts on wake.
+ */
+static void tickless_idle(void)
+{
+	U32 cycles_per_tick = SystemCoreClock / (1000U / uwTickFreq);
+	U32 max_ticks = SysTick_LOAD_RELOAD_Msk / cycles_per_tick;
+
+	// PRIMASK rather than a kernel critical section: WFI must still wake on the interrupts it masks.
+	__disable_irq();
+
+	// Another interrupt may have readied a task or already pended a tick.
+	if (k_sched_peek() != TID_NULL || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+	{
+		__enable_irq();
+		return;
+	}
+
+	U32 idle_ticks = k_timer_next_wakeup();
+	if (idle_ticks > max_ticks)
+	{
+		idle_ticks = max_ticks;
+	}
+	if (idle_ticks <= 1)
+	{
+		// Nothing to gain, sleep until the next tick as usual.
+		__WFI();
+		__enable_irq();
+		return;
+	}
+
+	// Keep what is left of the current tick and add the remaining whole ticks.
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	U32 reload = SysTick->VAL + (idle_ticks - 1) * cycles_per_tick;
+	SysTick->LOAD = reload;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+	__DSB();
+	__WFI();
+	__ISB();
+
+	// Reading CTRL clears COUNTFLAG, so sample it once.
+	U32 ctrl = SysTick->CTRL;
+	SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+	if (ctrl & SysTick_CTRL_COUNTFLAG_Msk)
+	{
+		// Slept the whole interval. The pending SysTick interrupt accounts for the last tick.
+		tick_advance(idle_ticks - 1);
+		SysTick->LOAD = cycles_per_tick - 1;
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	}
+	else
+	{
+		// Woken early by another interrupt. Count the whole ticks slept and finish the partial one.
+		U32 elapsed = reload - SysTick->VAL;
+		tick_advance(elapsed / cycles_per_tick);
+		SysTick->LOAD = cycles_per_tick - (elapsed % cycles_per_tick) - 1;
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		SysTick->LOAD = cycles_per_tick - 1;
+	}
+
+	__enable_irq();
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void port_init(void)
+{
+	SHPR3 |= 0xFFU << 24; //Set the priority of SysTick to be the weakest
+	SHPR3 |= 0xFEU << 16; //shift the constant 0xFE 16 bits to set PendSV priority
+	SHPR2 |= 0xFDU << 24; //set the priority of SVC higher than PendSV
+	// Stack FPU state only for tasks that used it, and defer S0-S15 until the handler touches the FPU.
+	FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+	// Start the DWT cycle counter used for CPU accounting and tracing.
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#if STACK_GUARD
+	// The default memory map stays in force for privileged code. Unprivileged code has none once the
+	// MPU is on, so flash, SRAM and the peripherals are mapped for it as they were before. The guard
+	// region is numbered above these and wins where it overlaps them.
+	// A guard hit is reported by MemManage_Handler instead of escalating to a hard fault.
+	MPU_REGION(0, FLASH_BASE, 19, MPU_AP_READ | MPU_NORMAL_WT);   //512 KB
+	MPU_REGION(1, SRAM1_BASE, 17, MPU_AP_FULL | MPU_NORMAL_WB);   //128 KB, covers the 96 KB of SRAM
+	MPU_REGION(2, PERIPH_BASE, 29, MPU_AP_FULL | MPU_DEVICE);     //APB, AHB1 and AHB2
+	port_set_stack_guard(0);
+	MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+	SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+	__DSB();
+	__ISB();
+#endif
+}
+
+/*
+ * Build the frame PendSV_Handler expects to restore a task from: the hardware exception frame,
+ * then the EXC_RETURN value and R4-R11 saved by software. New tasks start with no FPU context.
+ */
+U32* port_stack_init(TCB* tcb, U32* stack_top)
+{
+	U32* stackptr = stack_top;
+
+	*(--stackptr) = 1 << 24;                // xPSR, setting Thumb mode
+	*(--stackptr) = (U32)tcb->ptask;        // PC, function address
+	for (int i = 0; i < 6; i++) {           // LR, R12, R3-R0
+		*(--stackptr) = 0xA;
+	}
+	*(--stackptr) = EXC_RETURN_THREAD_PSP;  // EXC_RETURN, basic frame
+	for (int i = 0; i < 8; i++) {           // R11-R4
+		*(--stackptr) = 0xA;
+	}
+
+	return stackptr;
+}
+
+// The null task runs below the main stack, whose top is the first vector table entry.
+U32* port_null_stack(void)
+{
+	U32* MSP_INIT_VAL = *(U32**)0x0;
+	return MSP_INIT_VAL - MAIN_STACK_SIZE;
+}
+
+void port_start(void)
+{
+	HAL_Init();
+	// HAL_Init reprograms SysTick at TICK_INT_PRIORITY. Put it back at the lowest priority, as
+	// port_init set it, so k_crit_enter holds the tick off.
+	NVIC_SetPriority(SysTick_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+	// Calls os_kernel_start (lab1.s) which restores context of scheduled task.
+	__asm("SVC #1");
+}
+
+void port_idle(void)
+{
+#if TICKLESS_IDLE
+	// Suppress the tick until the next task wakes up
+	tickless_idle();
+#else
+	// Put the CPU in a low-power state or perform background tasks
+	__WFI(); // Wait For Interrupt, put CPU in sleep mode
+#endif
+}
+
+// The heap starts where the linker script ends the image.
+void* port_heap(void)
+{
+	return &_img_end;
+}
+
+// Unprivileged code can write SRAM (MPU region 1, or the default map) but not the running task's guard.
+int port_user_access(const void* addr, U32 size)
+{
+	UPTR start = (UPTR)addr;
+	UPTR end = (UPTR)&_estack;
+	if (start < SRAM1_BASE || start >= end || size > end - start)
+	{
+		return FALSE;
+	}
+
+	task_t tid = kernel_config.running_task;
+	UPTR guard = tid < MAX_TASKS ? kernel_config.TCBS[tid].stack_guard : 0;
+	return guard == 0 || start + size <= guard || start >= guard + PORT_STACK_GUARD_SIZE;
+}
+
+#endif /* RTX_PORT == PORT_CM4 */
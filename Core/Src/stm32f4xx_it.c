@@ -21,7 +21,9 @@
 #include "main.h"
 #include "stm32f4xx_it.h"
 #include "k_task.h"
+#include "port.h"
 #include "common.h"
+#include "bench.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 /* USER CODE END Includes */
@@ -100,7 +102,10 @@ void HardFault_Handler(void)
 void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+	// With STACK_GUARD, a task that runs off the bottom of its stack hits its guard region and lands
+	// here before it can touch the k_mem header below it. MMFAR holds the address it tried to access.
+	U32 address = (SCB->CFSR & SCB_CFSR_MMARVALID_Msk) ? SCB->MMFAR : 0;
+	printf("MEMMANAGE FAULT: task %u, address 0x%08X\r\n", kernel_config.running_task, address);
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
   {
@@ -199,37 +204,7 @@ void SysTick_Handler(void)
 
   //print_kernel_info();
 
-  if (!kernel_config.is_running) {
-    return;
-  }
-
-  for (int i = 1; i < MAX_TASKS; i++) {
-    //TCB task = kernel_config.TCBS[i];
-    
-    if (kernel_config.TCBS[i].state == TASK_READY || kernel_config.TCBS[i].state == TASK_RUNNING) {
-      if (kernel_config.TCBS[i].remaining_time == 0) {
-    	  kernel_config.TCBS[i].remaining_time = kernel_config.TCBS[i].deadline;
-      } else if(kernel_config.TCBS[i].remaining_time > 0){
-    	  kernel_config.TCBS[i].remaining_time--;
-      }
-
-    } else if (kernel_config.TCBS[i].state == TASK_SLEEPING) {
-      if (kernel_config.TCBS[i].remaining_sleep_time == 0) {
-    	  kernel_config.TCBS[i].state = TASK_READY;
-    	  kernel_config.TCBS[i].remaining_time = kernel_config.TCBS[i].deadline;
-    	  kernel_config.TCBS[i].remaining_time--;
-      }else if(kernel_config.TCBS[i].remaining_sleep_time > 0){
-    	  kernel_config.TCBS[i].remaining_sleep_time--;
-      }
-    }
-  }
-
-  /* 
-  
-  Scheduler call (placeholder till we know the function)
-  
-  */ 
-  ContextSwitch();
+  k_tick();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -240,6 +215,23 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f4xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles EXTI line[15:10] interrupts (B1 on PC13).
+  */
+void EXTI15_10_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI15_10_IRQn 0 */
+#if RTX_BENCHMARK
+  // Timestamp before anything else runs, this is the start of the wakeup latency.
+  bench_irq_entry();
+#endif
+  /* USER CODE END EXTI15_10_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(B1_Pin);
+  /* USER CODE BEGIN EXTI15_10_IRQn 1 */
+
+  /* USER CODE END EXTI15_10_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
 
 /* USER CODE END 1 */
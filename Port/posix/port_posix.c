@@ -0,0 +1,204 @@
+#include "port.h"
+#include "k_sched.h"
+#include "k_timer.h"
+#include "k_mem.h"
+#include "common.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+volatile sig_atomic_t port_masked = FALSE;
+volatile sig_atomic_t port_tick_pending = FALSE;
+volatile sig_atomic_t port_switch_pending = FALSE;
+U32* port_psp;
+#if PORT_SIM
+void (*port_sim_switch_hook)(task_t from, task_t to) = NULL;
+#endif
+
+// Tasks run on host stacks. The stack the pool gives a task is reserved but never touched.
+static ucontext_t contexts[MAX_TASKS];
+static U8 stacks[MAX_TASKS][PORT_STACK_SIZE] __attribute__((aligned(16)));
+static U32 heap[(1 << MAX_LEVEL) / sizeof(U32)] __attribute__((aligned(32)));
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+// PendSV_Handler's job: save the running task, let new_task pick the next one and restore it.
+static void context_switch(void)
+{
+#if PORT_SIM
+	task_t prev = kernel_config.running_task;
+#endif
+	ucontext_t* from = (ucontext_t*)port_psp;
+	new_task();
+	ucontext_t* to = (ucontext_t*)port_psp;
+	if (to != from)
+	{
+#if PORT_SIM
+		if (port_sim_switch_hook != NULL)
+		{
+			port_sim_switch_hook(prev, kernel_config.running_task);
+		}
+#endif
+		swapcontext(from, to);
+	}
+}
+
+#if !PORT_SIM
+// SysTick_Handler's job. A switch the tick pends is taken when k_tick leaves its critical section.
+static void tick_handler(int signal)
+{
+	int saved_errno = errno;
+	if (port_masked)
+	{
+		port_tick_pending = TRUE;
+	}
+	else
+	{
+		k_tick();
+	}
+	errno = saved_errno;
+}
+#endif
+
+// First code run by every task. The switch to it was made with the kernel masked.
+static void task_entry(void)
+{
+	port_crit_exit(FALSE);
+	kernel_config.TCBS[kernel_config.running_task].ptask(NULL);
+
+	// The target would fault on the bogus return address of the initial frame.
+	fprintf(stderr, "task %u returned from its function\n", kernel_config.running_task);
+	abort();
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+void port_run_pending(void)
+{
+	port_masked = TRUE;
+	// PendSV is more urgent than SysTick on the target, take the switch first.
+	while (port_tick_pending || port_switch_pending)
+	{
+		if (port_switch_pending)
+		{
+			port_switch_pending = FALSE;
+			context_switch();
+		}
+		if (port_tick_pending)
+		{
+			port_tick_pending = FALSE;
+			k_tick();
+		}
+	}
+	port_masked = FALSE;
+}
+
+void port_init(void)
+{
+	port_masked = FALSE;
+	port_tick_pending = FALSE;
+	port_switch_pending = FALSE;
+}
+
+U32* port_stack_init(TCB* tcb, U32* stack_top)
+{
+	ucontext_t* context = &contexts[tcb->tid];
+
+	getcontext(context);
+	context->uc_stack.ss_sp = stacks[tcb->tid];
+	context->uc_stack.ss_size = PORT_STACK_SIZE;
+	context->uc_link = NULL;
+	sigemptyset(&context->uc_sigmask);
+	makecontext(context, task_entry, 0);
+
+	return (U32*)context;
+}
+
+U32* port_null_stack(void)
+{
+	return (U32*)(stacks[TID_NULL] + PORT_STACK_SIZE);
+}
+
+void port_start(void)
+{
+#if !PORT_SIM
+	struct sigaction action = {0};
+	action.sa_handler = tick_handler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGALRM, &action, NULL);
+
+	struct itimerval timer = {0};
+	timer.it_interval.tv_sec = PORT_TICK_US / 1000000;
+	timer.it_interval.tv_usec = PORT_TICK_US % 1000000;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_REAL, &timer, NULL);
+#endif
+
+	setcontext((ucontext_t*)port_psp);
+}
+
+#if PORT_SIM
+// Tickless idle on the virtual clock: jump straight to the tick of the next wakeup or deadline.
+void port_idle(void)
+{
+	U32 ticks = k_timer_next_wakeup();
+	if (ticks == UINT_MAX)
+	{
+		fprintf(stderr, "idle at tick %llu with no task left to wake\n", kernel_config.tick_count);
+		exit(1);
+	}
+	if (ticks > 1)
+	{
+		k_timer_advance(ticks - 1);
+	}
+	k_tick();
+}
+
+void port_sim_run(U32 ticks)
+{
+	for (U32 i = 0; i < ticks; i++)
+	{
+		k_tick();
+	}
+}
+#else
+// WFI: block the tick, check nothing became ready, then wait for it with the check still valid.
+void port_idle(void)
+{
+	sigset_t tick;
+	sigset_t unmasked;
+
+	sigemptyset(&tick);
+	sigaddset(&tick, SIGALRM);
+	sigprocmask(SIG_BLOCK, &tick, &unmasked);
+	if (k_sched_peek() == TID_NULL)
+	{
+		sigsuspend(&unmasked);
+	}
+	sigprocmask(SIG_SETMASK, &unmasked, NULL);
+}
+#endif
+
+void* port_heap(void)
+{
+	return heap;
+}
+
+// The host has no privilege levels, system calls are never made from unprivileged code.
+int port_user_access(const void* addr, U32 size)
+{
+	return addr != NULL;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file port_posix.h
+ * @author Nicholas Cantone
+ * @date October 2026
+ * @brief Linux host port: tasks are ucontext coroutines in one process and SIGALRM is the tick.
+ *        Built with PORT_SIM=1 the tick runs on a virtual clock instead, see port_sim_run.
+ */
+
+#ifndef PORT_POSIX_H_
+#define PORT_POSIX_H_
+
+/************************************************
+ *               INCLUDES
+ ************************************************/
+
+#include "common.h"
+#include "k_task.h"
+#include <signal.h>
+#include <time.h>
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#ifndef PORT_TICK_US
+#define PORT_TICK_US      1000         //tick period in microseconds of wall clock time
+#endif
+#define PORT_STACK_SIZE   (64 * 1024)  //host stack of each task, libc and signal frames need more than STACK_SIZE
+#ifndef PORT_SIM
+#define PORT_SIM          0            //virtual clock: no SIGALRM, time passes only in port_sim_run and idle
+#endif
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+// Stand-ins for BASEPRI and the SysTick and PendSV pending bits.
+extern volatile sig_atomic_t port_masked;       //TRUE inside a kernel critical section
+extern volatile sig_atomic_t port_tick_pending; //a tick arrived while masked
+extern volatile sig_atomic_t port_switch_pending;
+extern U32* port_psp; //context of the running task, a ucontext_t
+#if PORT_SIM
+extern void (*port_sim_switch_hook)(task_t from, task_t to); //called on every switch to another task
+#endif
+
+/************************************************
+ *              FUNCTION DEFS
+ ************************************************/
+
+/*
+ * @brief: Takes the ticks and the switch that were held off by a critical section, as the NVIC
+ *         would once BASEPRI drops. Called with no section held.
+ */
+void port_run_pending(void);
+
+#if PORT_SIM
+/*
+ * @brief: The running task computes for ticks ticks of virtual time. The tick runs at the end of
+ *         each one, so the task is preempted and resumed exactly where the tick interrupt would do
+ *         it on the target. Only the time spent here and in idle advances the clock.
+ *
+ * @param ticks: ticks of computation.
+ */
+void port_sim_run(U32 ticks);
+#endif
+
+// A flag rather than sigprocmask, so a critical section costs no system call. The signal handler
+// defers the tick while it is set.
+static inline U32 port_crit_enter(void)
+{
+	U32 prev = port_masked;
+	port_masked = TRUE;
+	__asm volatile("" ::: "memory");
+	return prev;
+}
+
+static inline void port_crit_exit(U32 prev)
+{
+	__asm volatile("" ::: "memory");
+	port_masked = prev;
+	if (!prev && (port_tick_pending || port_switch_pending))
+	{
+		port_run_pending();
+	}
+}
+
+static inline void port_pend_switch(void)
+{
+	port_switch_pending = TRUE;
+	if (!port_masked)
+	{
+		port_run_pending();
+	}
+}
+
+static inline U32* port_get_psp(void)
+{
+	return port_psp;
+}
+
+static inline void port_set_psp(U32* sp)
+{
+	port_psp = sp;
+}
+
+#if PORT_SIM
+// Virtual microseconds, so CPU accounting is as deterministic as the schedule.
+static inline U32 port_cycles(void)
+{
+	return (U32)(kernel_config.tick_count * PORT_TICK_US);
+}
+#else
+// Nanoseconds of CLOCK_MONOTONIC stand in for cycles.
+static inline U32 port_cycles(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (U32)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+#endif
+
+// Tasks run on host stacks, there is nothing to guard in the k_mem block.
+#define PORT_STACK_GUARD_SIZE 0
+
+static inline UPTR port_stack_guard(U32* stack_mem)
+{
+	return 0;
+}
+
+static inline void port_set_stack_guard(UPTR guard)
+{
+}
+
+// Only one thread runs the kernel, so the increment just has to be a single instruction.
+static inline U32 port_fetch_inc(volatile U32* value)
+{
+	return __atomic_fetch_add(value, 1, __ATOMIC_RELAXED);
+}
+
+#endif /* PORT_POSIX_H_ */
@@ -0,0 +1,386 @@
+#include "k_task.h"
+#include "k_mem.h"
+#include "k_sync.h"
+#include "port.h"
+#include "common.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#define SIM_MAX_SEGMENTS   16       //compute, sleep, mutex and semaphore steps per job
+#define SIM_MUTEXES        4        //mutexes the segments can lock, l0 to l3
+#define SIM_SEMAPHORES     4        //semaphores the segments can take and give, t0 to t3
+#define SIM_NAME_LENGTH    16
+#define SIM_DURATION       3600000  //default run length in ticks, one hour at 1 ms
+
+// One step of a job, as written in the taskset file.
+typedef struct sim_segment_t {
+	char kind; //'c' computes and 's' sleeps for arg ticks, 'l' and 'u' lock and unlock mutex arg,
+	           //'t' and 'g' take and give semaphore arg
+	U32 arg;
+}SIM_SEGMENT;
+
+// One task of the replayed set. A job runs its segments in order, then the task waits for its next
+// period with osPeriodYield.
+typedef struct sim_task_t {
+	char name[SIM_NAME_LENGTH];
+	U32 period;
+	U32 deadline;
+	U32 wcet; //sum of the compute segments
+	SIM_SEGMENT segments[SIM_MAX_SEGMENTS];
+	U8 num_segments;
+	task_t tid;
+	U32 jobs;
+	U64 response_sum;
+	U32 worst_response;
+}SIM_TASK;
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+static SIM_TASK tasks[MAX_TASKS];
+static U32 num_tasks;
+static SIM_TASK *task_of[MAX_TASKS]; //indexed by TID
+static U32 duration = SIM_DURATION;
+static U8 admit = TRUE; //FALSE to skip admission control and let an overloaded set miss
+static FILE *schedule; //schedule trace, NULL if not written
+static U64 switches;
+static MUTEX mutexes[SIM_MUTEXES];
+static SEMAPHORE semaphores[SIM_SEMAPHORES];
+static double wall_start;
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+static double seconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static const char *task_name(task_t tid)
+{
+	if (tid == TID_NULL)
+	{
+		return "idle";
+	}
+	return task_of[tid] != NULL ? task_of[tid]->name : "sim";
+}
+
+static void on_switch(task_t, task_t to)
+{
+	switches++;
+	if (schedule != NULL)
+	{
+		fprintf(schedule, "%llu,%u,%s,run\n", kernel_config.tick_count, to, task_name(to));
+	}
+}
+
+// Called from k_tick when a job is still READY or RUNNING at its deadline.
+static void on_miss(task_t tid)
+{
+	if (schedule != NULL)
+	{
+		fprintf(schedule, "%llu,%u,%s,miss\n", kernel_config.tick_count, tid, task_name(tid));
+	}
+}
+
+static void sim_task(void *)
+{
+	SIM_TASK *task = task_of[osGetTID()];
+
+	while (1)
+	{
+		U64 release = kernel_config.TCBS[task->tid].release;
+		for (U32 i = 0; i < task->num_segments; i++)
+		{
+			SIM_SEGMENT *segment = &task->segments[i];
+			switch (segment->kind)
+			{
+			case 'c':
+				port_sim_run(segment->arg);
+				break;
+			case 's':
+				osSleep(segment->arg);
+				break;
+			case 'l':
+				osMutexLock(&mutexes[segment->arg]);
+				break;
+			case 'u':
+				osMutexUnlock(&mutexes[segment->arg]);
+				break;
+			case 't':
+				osSemTake(&semaphores[segment->arg]);
+				break;
+			default:
+				osSemGive(&semaphores[segment->arg]);
+				break;
+			}
+		}
+
+		U32 response = (U32)(kernel_config.tick_count - release);
+		task->jobs++;
+		task->response_sum += response;
+		if (response > task->worst_response)
+		{
+			task->worst_response = response;
+		}
+		osPeriodYield();
+	}
+}
+
+static void report(void)
+{
+	U64 ticks = kernel_config.tick_count;
+	double elapsed = seconds() - wall_start;
+	double total = (double)ticks * PORT_TICK_US;
+
+	printf("SIM,ticks,%llu,%.3f,%.0f\n", ticks, elapsed, ticks / elapsed);
+	printf("SIM,switches,%llu\n", switches);
+	printf("SIM,utilization,%.4f\n", (UTIL_FULL - osGetFreeUtilization()) / (double)UTIL_FULL);
+	printf("SIM,task,name,tid,period,deadline,wcet,jobs,misses,avg_response,worst_response,worst_lateness,cpu\n");
+	for (U32 i = 0; i < num_tasks; i++)
+	{
+		SIM_TASK *task = &tasks[i];
+		if (task->tid == TID_NULL)
+		{
+			continue;
+		}
+		TCB *tcb = &kernel_config.TCBS[task->tid];
+		printf("SIM,task,%s,%u,%u,%u,%u,%u,%u,%.2f,%u,%u,%.4f\n", task->name, task->tid, task->period,
+		       task->deadline, task->wcet, task->jobs, tcb->miss_count,
+		       task->jobs ? (double)task->response_sum / task->jobs : 0.0, task->worst_response,
+		       tcb->worst_lateness, tcb->run_cycles / total);
+	}
+	printf("SIM,idle,%.4f\n", kernel_config.TCBS[TID_NULL].run_cycles / total);
+}
+
+// Most urgent task of the run: sleeps for the whole simulation, then reports and ends it.
+static void end_task(void *)
+{
+	osSleep(duration);
+	report();
+	if (schedule != NULL)
+	{
+		fclose(schedule);
+	}
+	exit(0);
+}
+
+// Parse "name period deadline c2 l0 c1 u0 s5 c1". Returns FALSE for blank and comment lines.
+static int parse_task(char *line, SIM_TASK *task)
+{
+	char *token = strtok(line, " \t\r\n");
+	if (token == NULL || token[0] == '#')
+	{
+		return FALSE;
+	}
+	memset(task, 0, sizeof(*task));
+	snprintf(task->name, SIM_NAME_LENGTH, "%s", token);
+
+	char *period = strtok(NULL, " \t\r\n");
+	char *deadline = strtok(NULL, " \t\r\n");
+	if (period == NULL || deadline == NULL)
+	{
+		fprintf(stderr, "%s: expected name period deadline segments...\n", task->name);
+		exit(2);
+	}
+	task->period = strtoul(period, NULL, 10);
+	task->deadline = strtoul(deadline, NULL, 10);
+
+	while ((token = strtok(NULL, " \t\r\n")) != NULL && token[0] != '#')
+	{
+		int arg = atoi(token + 1);
+		int timed = token[0] == 'c' || token[0] == 's';
+		int mutex = token[0] == 'l' || token[0] == 'u';
+		int sem = token[0] == 't' || token[0] == 'g';
+		if ((timed && arg <= 0) || (mutex && (arg < 0 || arg >= SIM_MUTEXES)) ||
+		    (sem && (arg < 0 || arg >= SIM_SEMAPHORES)) || (!timed && !mutex && !sem) ||
+		    task->num_segments == SIM_MAX_SEGMENTS)
+		{
+			fprintf(stderr, "%s: bad segment %s, expected c<ticks>, s<ticks>, l<mutex>, u<mutex>, t<sem> or g<sem>\n",
+			        task->name, token);
+			exit(2);
+		}
+		SIM_SEGMENT *segment = &task->segments[(U32)task->num_segments++];
+		segment->kind = token[0];
+		segment->arg = arg;
+		task->wcet += token[0] == 'c' ? arg : 0;
+	}
+	return TRUE;
+}
+
+static void load_tasks(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+	{
+		perror(path);
+		exit(2);
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL && num_tasks < MAX_TASKS - 2)
+	{
+		if (parse_task(line, &tasks[num_tasks]))
+		{
+			num_tasks++;
+		}
+	}
+	fclose(file);
+}
+
+static double random_unit(U32 *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return (*state >> 8) / (double)(1 << 24);
+}
+
+// UUniFast: n implicit deadline tasks sharing utilization u, with periods from a harmonic-ish set.
+static void generate_tasks(U32 n, double u, U32 seed)
+{
+	static const U32 periods[] = {10, 20, 25, 40, 50, 100, 200, 250, 500, 1000};
+	U32 state = seed != 0 ? seed : 1;
+	double left = u;
+
+	for (num_tasks = 0; num_tasks < n && num_tasks < MAX_TASKS - 2; num_tasks++)
+	{
+		double share = left;
+		if (num_tasks < n - 1)
+		{
+			double next = left * pow(random_unit(&state), 1.0 / (n - num_tasks - 1));
+			share = left - next;
+			left = next;
+		}
+
+		SIM_TASK *task = &tasks[num_tasks];
+		memset(task, 0, sizeof(*task));
+		snprintf(task->name, SIM_NAME_LENGTH, "t%u", num_tasks);
+		task->period = periods[(U32)(random_unit(&state) * (sizeof(periods) / sizeof(periods[0])))];
+		task->deadline = task->period;
+		task->wcet = (U32)(share * task->period + 0.5);
+		task->wcet = task->wcet != 0 ? task->wcet : 1;
+		task->segments[0].kind = 'c';
+		task->segments[0].arg = task->wcet;
+		task->num_segments = 1;
+	}
+}
+
+static task_t spawn(void (*ptask)(void *args), U32 period, U32 deadline, U32 wcet)
+{
+	TCB task = {0};
+	task.stack_size = STACK_SIZE;
+	task.ptask = ptask;
+	task.wcet = wcet;
+	if (osCreatePeriodicTask(period, deadline, &task) != RTX_OK)
+	{
+		return TID_NULL;
+	}
+	return task.tid;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: rtx_sim [-d ticks] [-o schedule.csv] [-n] (taskset | -g tasks,utilization,seed)\n");
+	exit(2);
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+	const char *path = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+		{
+			duration = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			schedule = fopen(argv[++i], "w");
+			if (schedule == NULL)
+			{
+				perror(argv[i]);
+				return 2;
+			}
+			fprintf(schedule, "tick,tid,task,event\n");
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			admit = FALSE;
+		}
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+		{
+			U32 n;
+			double u;
+			U32 seed;
+			if (sscanf(argv[++i], "%u,%lf,%u", &n, &u, &seed) != 3 || n == 0)
+			{
+				usage();
+			}
+			generate_tasks(n, u, seed);
+		}
+		else if (argv[i][0] != '-' && path == NULL)
+		{
+			path = argv[i];
+		}
+		else
+		{
+			usage();
+		}
+	}
+	if (path != NULL)
+	{
+		load_tasks(path);
+	}
+	if (num_tasks == 0 || duration == 0 || duration > INT32_MAX)
+	{
+		usage();
+	}
+
+	osKernelInit();
+	k_mem_init();
+	for (int i = 0; i < SIM_MUTEXES; i++)
+	{
+		osMutexInit(&mutexes[i]);
+	}
+	for (int i = 0; i < SIM_SEMAPHORES; i++)
+	{
+		osSemInit(&semaphores[i], 0, 0xFFFFFFFF);
+	}
+	port_sim_switch_hook = &on_switch;
+
+	// Created first with the shortest deadline, so it gets the CPU as soon as the time is up.
+	spawn(&end_task, duration, 1, 0);
+
+	// Every task is released at tick 0, the critical instant.
+	for (U32 i = 0; i < num_tasks; i++)
+	{
+		SIM_TASK *task = &tasks[i];
+		task->tid = spawn(&sim_task, task->period, task->deadline, admit ? task->wcet : 0);
+		if (task->tid == TID_NULL)
+		{
+			printf("SIM,rejected,%s,%u,%u,%u\n", task->name, task->period, task->deadline, task->wcet);
+			continue;
+		}
+		task_of[task->tid] = task;
+		osSetMissPolicy(task->tid, MISS_POLICY_CALLBACK, &on_miss);
+	}
+
+	wall_start = seconds();
+	osKernelStart();
+	return 1;
+}
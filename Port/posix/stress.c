@@ -0,0 +1,301 @@
+#include "k_task.h"
+#include "k_mem.h"
+#include "k_sync.h"
+#include "common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************
+ *               DEFINITIONS
+ ************************************************/
+
+#define STRESS_YIELDS     1000000  //osYield calls per task count
+#define STRESS_ALLOCS     1000000  //k_mem_alloc and k_mem_dealloc pairs
+#define STRESS_LIVE       32       //allocations held at once by the allocator test
+#define STRESS_MAX_ALLOC  1024     //largest allocation in bytes
+#define STRESS_TICKS      200      //ticks the sleep test runs for
+#define STRESS_DEADLINE   5        //deadline of every task, in ticks
+#define STRESS_WORKERS    1000000  //short-lived tasks created and torn down by the churn test
+#define STRESS_SLACK      1000     //deadline of the churn test's creator, far behind its workers
+#define STRESS_BLOCKED    30       //ticks the deadline test keeps its waiter BLOCKED, past its first deadline
+
+/************************************************
+ *               GLOBALS
+ ************************************************/
+
+static volatile U32 yields; //osYield or osYieldTo calls made by all tasks in the current test
+static volatile U32 wakeups; //osSleep returns in the current test
+static volatile U32 workers; //churn test workers that ran to osTaskExit
+static volatile U32 worker_failed; //churn test creations that found no TID or stack
+static volatile double churn_elapsed;
+static volatile U8 stop;
+static task_t ring[MAX_TASKS]; //TIDs in the order the switch test hands the CPU around
+static volatile U16 ring_size;
+static MUTEX held; //locked by the controller while the deadline test's waiter blocks on it
+
+/************************************************
+ *               HELPER FUNCTIONS
+ ************************************************/
+
+static double seconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Only the controller prints. The tick preempts tasks anywhere, including inside the C library.
+static void report(const char *name, U32 tasks, U32 events, double elapsed)
+{
+	printf("STRESS,%s,%u,%u,%.3f,%.0f\n", name, tasks, events, elapsed, events / elapsed);
+	fflush(stdout);
+}
+
+// Create a task with the minimum stack. Returns its TID, or TID_NULL on failure.
+static task_t spawn(void (*ptask)(void *args), int deadline)
+{
+	TCB task = {0};
+	task.stack_size = STACK_SIZE;
+	task.ptask = ptask;
+	if (osCreateDeadlineTask(deadline, &task) != RTX_OK)
+	{
+		return TID_NULL;
+	}
+	return task.tid;
+}
+
+// Sleep until only ntasks tasks, including the controller, are left.
+static void wait_tasks(U16 ntasks)
+{
+	while (kernel_config.num_running_tasks > ntasks)
+	{
+		osSleep(1);
+	}
+}
+
+static void yield_task(void *)
+{
+	while (!stop)
+	{
+		osYield();
+		yields++;
+	}
+	osTaskExit();
+}
+
+// Hand the CPU to the next task in the ring, a real switch on every call.
+static void ring_yield(void)
+{
+	task_t self = osGetTID();
+	U16 i = 0;
+	while (ring[i] != self)
+	{
+		i++;
+	}
+	osYieldTo(ring[(i + 1) % ring_size]);
+}
+
+static void ring_task(void *)
+{
+	while (!stop)
+	{
+		ring_yield();
+		yields++;
+	}
+	osTaskExit();
+}
+
+static void sleep_task(void *)
+{
+	while (!stop)
+	{
+		osSleep(1);
+		wakeups++;
+	}
+	osTaskExit();
+}
+
+// Preempts its creator, counts itself and exits.
+static void worker_task(void *)
+{
+	workers++;
+	osTaskExit();
+}
+
+// Creates workers one after another. It never idles, so the workers that exited are reaped by
+// osCreateDeadlineTask once it runs out of TIDs.
+static void churn_task(void *)
+{
+	double start = seconds();
+	while (workers < STRESS_WORKERS)
+	{
+		if (spawn(&worker_task, 1) == TID_NULL)
+		{
+			worker_failed++;
+		}
+	}
+	churn_elapsed = seconds() - start;
+	osTaskExit();
+}
+
+// Blocks on the mutex the controller holds, then exits.
+static void waiter_task(void *)
+{
+	osMutexLock(&held);
+	osMutexUnlock(&held);
+	osTaskExit();
+}
+
+// osSetDeadline on a BLOCKED task: the deadline it had when it blocked must not expire as a miss.
+static void blocked_deadline_test(void)
+{
+	osMutexInit(&held);
+	osMutexLock(&held);
+	task_t waiter = spawn(&waiter_task, 2 * STRESS_DEADLINE);
+	osSleep(1);
+	osSetDeadline(STRESS_SLACK, waiter);
+	osSleep(STRESS_BLOCKED);
+	U32 missed = kernel_config.TCBS[waiter].miss_count;
+	osMutexUnlock(&held);
+	wait_tasks(1);
+	printf("STRESS,blocked_miss,%u\n", missed);
+}
+
+static U32 random_next(U32 *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+// Random allocations and frees with a pattern written to each block and checked before it is freed.
+static void alloc_test(void)
+{
+	U8 *blocks[STRESS_LIVE] = {0};
+	U32 sizes[STRESS_LIVE] = {0};
+	U32 seed = 0x2545F491;
+	U32 failed = 0;
+	U32 corrupt = 0;
+
+	double start = seconds();
+	for (U32 i = 0; i < STRESS_ALLOCS; i++)
+	{
+		U32 slot = random_next(&seed) % STRESS_LIVE;
+		if (blocks[slot] != NULL)
+		{
+			for (U32 j = 0; j < sizes[slot]; j++)
+			{
+				corrupt += blocks[slot][j] != (U8)slot;
+			}
+			k_mem_dealloc(blocks[slot]);
+		}
+
+		sizes[slot] = 1 + random_next(&seed) % STRESS_MAX_ALLOC;
+		blocks[slot] = k_mem_alloc(sizes[slot]);
+		if (blocks[slot] == NULL)
+		{
+			failed++;
+			continue;
+		}
+		for (U32 j = 0; j < sizes[slot]; j++)
+		{
+			blocks[slot][j] = (U8)slot;
+		}
+	}
+	report("alloc", 1, STRESS_ALLOCS, seconds() - start);
+	printf("STRESS,alloc_failed,%u\nSTRESS,alloc_corrupt,%u\n", failed, corrupt);
+
+	for (U32 slot = 0; slot < STRESS_LIVE; slot++)
+	{
+		k_mem_dealloc(blocks[slot]);
+	}
+}
+
+static void controller_task(void *)
+{
+	printf("STRESS,test,tasks,events,seconds,events_per_second\n");
+
+	for (U16 ntasks = 2; ntasks <= MAX_TASKS - 1; ntasks *= 2)
+	{
+		// osYield with equal deadlines: the ties go to the lowest TID, so this is mostly a
+		// scheduler pass that returns to the controller.
+		stop = FALSE;
+		yields = 0;
+		for (U16 i = 1; i < ntasks; i++)
+		{
+			spawn(&yield_task, STRESS_DEADLINE);
+		}
+		double start = seconds();
+		while (yields < STRESS_YIELDS)
+		{
+			osYield();
+			yields++;
+		}
+		double elapsed = seconds() - start;
+		stop = TRUE;
+		report("yield", ntasks, yields, elapsed);
+		wait_tasks(1);
+
+		// osYieldTo around a ring of tasks, a full context switch per call.
+		stop = FALSE;
+		yields = 0;
+		ring_size = 0;
+		ring[ring_size++] = osGetTID();
+		for (U16 i = 1; i < ntasks; i++)
+		{
+			ring[ring_size++] = spawn(&ring_task, STRESS_DEADLINE);
+		}
+		start = seconds();
+		while (yields < STRESS_YIELDS)
+		{
+			ring_yield();
+			yields++;
+		}
+		elapsed = seconds() - start;
+		stop = TRUE;
+		report("switch", ntasks, yields, elapsed);
+		wait_tasks(1);
+	}
+
+	// Tasks sleeping one tick at a time: timer queue inserts, tick releases and wakeup switches.
+	stop = FALSE;
+	wakeups = 0;
+	for (U16 i = 2; i < MAX_TASKS; i++)
+	{
+		spawn(&sleep_task, STRESS_DEADLINE);
+	}
+	double start = seconds();
+	osSleep(STRESS_TICKS);
+	report("sleep", MAX_TASKS - 2, wakeups, seconds() - start);
+	stop = TRUE;
+	wait_tasks(1);
+
+	// Short-lived workers: each one is created, preempts its creator at once and exits.
+	workers = 0;
+	worker_failed = 0;
+	spawn(&churn_task, STRESS_SLACK);
+	wait_tasks(1);
+	report("churn", 2, workers, churn_elapsed);
+	printf("STRESS,churn_failed,%u\n", worker_failed);
+
+	blocked_deadline_test();
+
+	alloc_test();
+
+	exit(0);
+}
+
+/************************************************
+ *               FUNCTIONS
+ ************************************************/
+
+int main(void)
+{
+	osKernelInit();
+	k_mem_init();
+	spawn(&controller_task, STRESS_DEADLINE);
+	osKernelStart();
+	return 1;
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Decode a dump of the kernel's trace_buffer (Core/Inc/k_trace.h) into a timeline.
+
+Dump the buffer from a halted target with gdb:
+
+    (gdb) dump binary value trace.bin trace_buffer
+
+then run:
+
+    python3 tools/trace_decode.py trace.bin [--hz 84000000]
+"""
+
+import argparse
+import collections
+import struct
+import sys
+
+TRACE_MAGIC = 0x54585452
+HEADER = struct.Struct("<IIII")   # magic, record_size, capacity, head
+RECORD = struct.Struct("<IHBBI")  # cycles, tick, event, tid, arg
+
+# Same numbering as the TRACE_* defines in k_trace.h.
+EVENTS = {
+    1: "switch",
+    2: "wake",
+    3: "sleep",
+    4: "alloc",
+    5: "free",
+    6: "miss",
+    7: "create",
+    8: "exit",
+    9: "block",
+}
+
+
+def describe(event, arg):
+    if event == 1:
+        return "from tid %d" % arg
+    if event == 2:
+        return {0: "by timer", 1: "by isr", 2: "by mutex", 3: "by semaphore"}.get(arg, "by %d" % arg)
+    if event == 3:
+        return "until tick %d" % arg
+    if event == 4:
+        return "0x%08x" % arg if arg else "failed"
+    if event == 5:
+        return "0x%08x" % arg
+    if event == 6:
+        return "miss #%d" % arg
+    if event == 7:
+        return "deadline %d" % arg
+    if event == 9:
+        return "on tid %d" % arg if arg else "on semaphore"
+    return ""
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit("%s: too short for a trace header" % path)
+
+    magic, record_size, capacity, head = HEADER.unpack_from(data, 0)
+    if magic != TRACE_MAGIC:
+        sys.exit("%s: bad magic 0x%08x, not a trace_buffer dump" % (path, magic))
+    if record_size != RECORD.size:
+        sys.exit("%s: record size %d, expected %d" % (path, record_size, RECORD.size))
+    if len(data) < HEADER.size + capacity * record_size:
+        sys.exit("%s: truncated, expected %d records" % (path, capacity))
+
+    # head counts every record ever written. Once it passes capacity the oldest record is at head.
+    count = min(head, capacity)
+    first = head - count
+    records = []
+    for n in range(first, head):
+        offset = HEADER.size + (n % capacity) * record_size
+        records.append(RECORD.unpack_from(data, offset))
+    return head, capacity, records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="binary dump of trace_buffer")
+    parser.add_argument("--hz", type=int, default=0, help="core clock, prints times in microseconds")
+    args = parser.parse_args()
+
+    head, capacity, records = load(args.dump)
+    if head > capacity:
+        print("# %d records written, the oldest %d were overwritten" % (head, head - capacity))
+
+    # The cycle counter wraps every 2^32 cycles, unwrap it assuming records are less than a wrap apart.
+    # When it never ran (QEMU) fall back to the tick.
+    use_cycles = any(r[0] for r in records)
+    base = None
+    last = 0
+    time = 0
+    counts = collections.Counter()
+    for cycles, tick, event, tid, arg in records:
+        if use_cycles:
+            if base is None:
+                base = last = cycles
+            time += (cycles - last) & 0xFFFFFFFF
+            last = cycles
+            stamp = "%.3f us" % (time * 1e6 / args.hz) if args.hz else "%d cyc" % time
+        else:
+            stamp = "tick %d" % tick
+        name = EVENTS.get(event, "event%d" % event)
+        counts[name] += 1
+        print("%14s  %-6s tid %-3d %s" % (stamp, name, tid, describe(event, arg)))
+
+    print()
+    for name, n in sorted(counts.items()):
+        print("# %-6s %d" % (name, n))
+
+
+if __name__ == "__main__":
+    main()